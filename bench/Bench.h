@@ -0,0 +1,130 @@
+#ifndef MYAI_BENCH_BENCH_H_
+#define MYAI_BENCH_BENCH_H_
+
+#include "core/define.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+MYAI_BEGIN
+namespace bench {
+
+// 全局分配计数，由 bench_main.cpp 中替换的 operator new 维护
+extern std::atomic<uint64> g_alloc_bytes;
+extern std::atomic<uint64> g_alloc_count;
+
+struct BenchConfig {
+	size_t nodes	   = 20000;// 宏基准的合成图节点数
+	size_t fanout	   = 16;   // 每个节点的出边数
+	size_t cycles	   = 10;   // MyaiController 推理轮数
+	size_t min_time_ms = 200;  // 每个基准的最短测量时间
+	size_t min_samples = 16;   // 每个基准的最少采样数
+	uint32 seed		   = 20241214;
+	String filter;			   // 只运行名称包含该字符串的基准
+	String data_path   = "./bench_data";
+};
+
+struct BenchResult {
+	String name;
+	uint64 ops			  = 0;
+	double seconds		  = 0;
+	double ops_per_sec	  = 0;
+	double p50_ns		  = 0;// 单个操作的延迟
+	double p99_ns		  = 0;
+	uint64 bytes_per_op	  = 0;
+	uint64 allocs_per_op  = 0;
+	uint64 bytes_allocated= 0;
+	String error;
+};
+
+/**
+ * @brief 基准的执行上下文
+ * @details measure 以 batch 个操作为一次采样计时，
+ *          延迟取采样时间除以 batch，避免计时开销淹没微基准
+ */
+class BenchContext {
+public:
+	BenchContext(const BenchConfig &config, BenchResult &result) : m_config(config), m_result(result) {}
+
+	const BenchConfig &config() const { return m_config; }
+
+	/**
+	 * @brief 重复执行 fn(batch) 直到达到最短时间和最少采样数
+	 * @param fn 执行 batch 个操作，准备工作应放在 measure 之外
+	 * @param max_samples 采样数上限，0 表示不限制
+	 */
+	template<typename Fn>
+	void measure(size_t batch, Fn &&fn, size_t max_samples = 0) {
+		using clock = std::chrono::steady_clock;
+		std::vector<double> samples;
+		const auto min_time	  = std::chrono::milliseconds(m_config.min_time_ms);
+		const uint64 bytes0	  = g_alloc_bytes.load(std::memory_order_relaxed);
+		const uint64 count0	  = g_alloc_count.load(std::memory_order_relaxed);
+		const auto begin	  = clock::now();
+		clock::duration total = clock::duration::zero();
+
+		while ((total < min_time || samples.size() < m_config.min_samples) &&
+			   (max_samples == 0 || samples.size() < max_samples)) {
+			const auto t0 = clock::now();
+			fn(batch);
+			const auto t1 = clock::now();
+			total += t1 - t0;
+			samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / batch);
+			// 防止单次很慢的基准无限运行
+			if (clock::now() - begin > 20 * min_time && samples.size() >= 3) break;
+		}
+
+		const uint64 ops   = samples.size() * batch;
+		const uint64 bytes = g_alloc_bytes.load(std::memory_order_relaxed) - bytes0;
+		const uint64 count = g_alloc_count.load(std::memory_order_relaxed) - count0;
+		std::sort(samples.begin(), samples.end());
+
+		m_result.ops			 = ops;
+		m_result.seconds		 = std::chrono::duration<double>(total).count();
+		m_result.ops_per_sec	 = m_result.seconds > 0 ? ops / m_result.seconds : 0;
+		m_result.p50_ns			 = percentile(samples, 0.50);
+		m_result.p99_ns			 = percentile(samples, 0.99);
+		m_result.bytes_allocated = bytes;
+		m_result.bytes_per_op	 = ops ? bytes / ops : 0;
+		m_result.allocs_per_op	 = ops ? count / ops : 0;
+	}
+
+private:
+	static double percentile(const std::vector<double> &sorted, double p) {
+		if (sorted.empty()) return 0;
+		return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5))];
+	}
+
+private:
+	const BenchConfig &m_config;
+	BenchResult &m_result;
+};
+
+using BenchFunc = std::function<void(BenchContext &)>;
+
+struct BenchEntry {
+	String name;
+	BenchFunc func;
+};
+
+inline std::vector<BenchEntry> &registry() {
+	static std::vector<BenchEntry> s_registry;
+	return s_registry;
+}
+
+struct BenchRegistrar {
+	BenchRegistrar(const char *name, BenchFunc func) { registry().push_back(BenchEntry{name, std::move(func)}); }
+};
+
+}// namespace bench
+MYAI_END
+
+#define MYAI_BENCH(ID, NAME)                                                           \
+	static void ID##_bench(::MYAI_SPACE::bench::BenchContext &);                       \
+	static ::MYAI_SPACE::bench::BenchRegistrar ID##_registrar(NAME, ID##_bench);         \
+	static void ID##_bench(::MYAI_SPACE::bench::BenchContext &ctx)
+
+#endif// !MYAI_BENCH_BENCH_H_
@@ -0,0 +1,158 @@
+#include "Bench.h"
+
+#include "core/MyaiController.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+MYAI_BEGIN
+namespace bench {
+namespace {
+
+constexpr nodeid_t CONTROLLER_ID_BEGIN = MyaiController::ID_BEGIN;
+constexpr size_t CONTROLLER_ID_SIZE	   = MyaiController::ID_SIZE;
+
+/**
+ * @brief 在 data_path 下生成合成图
+ * @details 先申请驱动保留的id块，使控制器启动后驱动id不变，
+ *          再创建 nodes 个节点，每个节点 fanout 条随机出边
+ * @return 图中节点的id
+ */
+std::vector<nodeid_t> build_graph(const BenchConfig &config, const String &data_path, IdAllocator &alloc) {
+	std::mt19937 rng(config.seed);
+	auto dao = std::make_shared<MyaiDao>(data_path);
+	alloc.allocate(DriverManager::RESERVED_ID_SIZE);
+
+	std::vector<nodeid_t> ids;
+	const size_t node_num = std::min(config.nodes, CONTROLLER_ID_SIZE - DriverManager::RESERVED_ID_SIZE - 1);
+	for (size_t i = 0; i < node_num; ++i) {
+		ids.push_back(alloc.allocate());
+	}
+
+	std::uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+	std::uniform_real_distribution<weight_t> weight_dist(0.0f, 1.0f);
+	for (auto id: ids) {
+		auto node = MyaiNode::create(id, weight_dist(rng), MyaiNode::NDS_READY);
+		for (size_t k = 0; k < config.fanout; ++k) {
+			node->links().emplace(ids[pick(rng)], weight_dist(rng));
+		}
+		dao->insert(node);
+	}
+	return ids;
+}
+
+// 文本驱动的第一个id，驱动的id块按 DriverManager::init 的顺序申请
+constexpr nodeid_t STRING_ID_BEGIN = CONTROLLER_ID_BEGIN + DriverManager::STATUS_ID_SIZE + DriverManager::MEMORY_ID_SIZE;
+
+/**
+ * @brief 为控制器准备文本输入
+ * @details 输入为随机小写字母，每个字母的输入词元节点连到图中 fanout 个随机节点，
+ *          使首轮激活进入合成图，之后由激活结果逐轮扩散
+ */
+void build_text_input(const BenchConfig &config, const String &data_path, const std::vector<nodeid_t> &ids) {
+	std::mt19937 rng(config.seed + 1);
+	std::uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+	std::uniform_real_distribution<weight_t> weight_dist(0.5f, 1.0f);
+	auto dao = std::make_shared<MyaiDao>(data_path + "/data");
+	for (char c = 'a'; c <= 'z'; ++c) {
+		auto node = MyaiNode::create(STRING_ID_BEGIN + static_cast<uint8_t>(c), 0.0f, MyaiNode::NDS_READY);
+		for (size_t k = 0; k < config.fanout; ++k) {
+			node->links().emplace(ids[pick(rng)], weight_dist(rng));
+		}
+		dao->insert(node);
+	}
+
+	std::ofstream text(data_path + "/input.txt", std::ios::binary | std::ios::trunc);
+	std::uniform_int_distribution<int> letter('a', 'z');
+	for (size_t i = 0; i < 4096; ++i) {
+		text.put(static_cast<char>(letter(rng)));
+	}
+}
+
+// 在 path 目录下运行，结束后恢复工作目录
+class ScopedWorkDir {
+public:
+	explicit ScopedWorkDir(const String &path) : m_old(std::filesystem::current_path()) {
+		std::filesystem::create_directories(path);
+		std::filesystem::current_path(path);
+	}
+	~ScopedWorkDir() { std::filesystem::current_path(m_old); }
+
+private:
+	std::filesystem::path m_old;
+};
+
+}// namespace
+}// namespace bench
+MYAI_END
+
+using namespace MYAI_SPACE;
+using namespace MYAI_SPACE::bench;
+
+MYAI_BENCH(controller_run, "controller/run") {
+	{
+		IdAllocator alloc(CONTROLLER_ID_BEGIN, CONTROLLER_ID_SIZE);
+		const auto ids = build_graph(ctx.config(), ctx.config().data_path + "/data", alloc);
+		build_text_input(ctx.config(), ctx.config().data_path, ids);
+		alloc.save(ctx.config().data_path + "/data/id_alloc.dat");
+	}
+	ScopedWorkDir work_dir(ctx.config().data_path);
+
+	DriverConfig driver_config;
+	driver_config.text_input = "input.txt";
+	MyaiController controller(ctx.config().cycles, driver_config);
+	controller.init();
+	// 每次采样为一次 run：cycles 轮推理和一次批量训练，单个操作为一轮推理（分摊训练）
+	ctx.measure(ctx.config().cycles, [&](size_t) { controller.run(); });
+	controller.destroy();
+	// 前沿为空时计时与图无关，作为错误报告
+	if (controller.frontierStatistics().activated == 0) MYLIB_THROW("bench error: controller activated no graph node");
+}
+
+MYAI_BENCH(service_activate, "service/activate") {
+	// 从随机种子节点出发逐跳激活，每跳取上一跳结果作为前沿
+	IdAllocator::ptr alloc = std::make_shared<IdAllocator>(CONTROLLER_ID_BEGIN, CONTROLLER_ID_SIZE);
+	const auto ids		   = build_graph(ctx.config(), ctx.config().data_path, *alloc);
+	auto dao			   = std::make_shared<MyaiDao>(ctx.config().data_path);
+	auto service		   = std::make_shared<MyaiService>(dao, alloc, MyaiCache::DEF_MEMORY_BUDGET,
+														   std::make_shared<ThreadPool>());
+
+	std::mt19937 rng(ctx.config().seed);
+	std::uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+	const size_t seed_num = 64, hop_num = 3;
+	ctx.measure(hop_num, [&](size_t hops) {
+		std::vector<Edge> frontier;
+		for (size_t i = 0; i < seed_num; ++i) {
+			frontier.emplace_back(ids[pick(rng)], 1.0f);
+		}
+		for (size_t h = 0; h < hops; ++h) {
+			auto out = std::make_shared<EdgeList>();
+			service->activatedNodes(out, frontier);
+			frontier.clear();
+			for (auto &&[id, edge]: *out) {
+				frontier.emplace_back(edge);
+			}
+		}
+	}, std::max<size_t>(ctx.config().cycles, ctx.config().min_samples));
+}
+
+MYAI_BENCH(snapshot_open, "snapshot/open") {
+	// 启动开销：映射快照并读取一个节点的链接
+	IdAllocator alloc(CONTROLLER_ID_BEGIN, CONTROLLER_ID_SIZE);
+	const auto ids	  = build_graph(ctx.config(), ctx.config().data_path, alloc);
+	const String path = ctx.config().data_path + "/graph.csr";
+	{
+		MyaiDao dao(ctx.config().data_path);
+		GraphSnapshot::save(dao, path);
+	}
+
+	std::mt19937 rng(ctx.config().seed);
+	std::uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+	ctx.measure(1, [&](size_t) {
+		GraphSnapshot snapshot;
+		snapshot.open(path);
+		GraphSnapshot::Row row;
+		snapshot.view(ids[pick(rng)], row);
+	});
+}
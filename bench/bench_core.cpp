@@ -0,0 +1,236 @@
+#include "Bench.h"
+
+#include "core/IdAllocator.h"
+#include "core/MyaiFileIO.h"
+
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <thread>
+
+MYAI_BEGIN
+namespace bench {
+namespace {
+
+// 随机边，id在 [1, id_max] 内
+std::vector<Edge> random_edges(std::mt19937 &rng, size_t n, nodeid_t id_max) {
+	std::uniform_int_distribution<nodeid_t> id_dist(1, id_max);
+	std::uniform_real_distribution<weight_t> weight_dist(-1.0f, 1.0f);
+	std::vector<Edge> edges;
+	edges.reserve(n);
+	for (size_t i = 0; i < n; ++i) {
+		edges.emplace_back(id_dist(rng), weight_dist(rng));
+	}
+	return edges;
+}
+
+MyaiNode::ptr random_node(std::mt19937 &rng, nodeid_t id, size_t fanout, nodeid_t id_max) {
+	auto node = MyaiNode::create(id, 0.5f, MyaiNode::NDS_READY);
+	for (auto &edge: random_edges(rng, fanout, id_max)) {
+		node->links().emplace(edge);
+	}
+	return node;
+}
+
+}// namespace
+}// namespace bench
+MYAI_END
+
+using namespace MYAI_SPACE;
+using namespace MYAI_SPACE::bench;
+
+//=================================================================
+// EdgeList
+//=================================================================
+
+MYAI_BENCH(edgelist_emplace, "edgelist/emplace") {
+	std::mt19937 rng(ctx.config().seed);
+	const auto edges = random_edges(rng, 4096, 1 << 20);
+	ctx.measure(edges.size(), [&](size_t n) {
+		EdgeList list;
+		for (size_t i = 0; i < n; ++i) {
+			list.emplace(edges[i]);
+		}
+	});
+}
+
+MYAI_BENCH(edgelist_insert, "edgelist/insert") {
+	// 每个操作把一个 fanout 大小的表累加到公共结果表，模拟激活时的合并
+	std::mt19937 rng(ctx.config().seed);
+	std::vector<EdgeList> lists(256);
+	for (auto &list: lists) {
+		for (auto &edge: random_edges(rng, ctx.config().fanout, 1 << 16)) {
+			list.emplace(edge);
+		}
+	}
+	ctx.measure(lists.size(), [&](size_t n) {
+		EdgeList out;
+		for (size_t i = 0; i < n; ++i) {
+			out.insert(lists[i]);
+		}
+	});
+}
+
+//=================================================================
+// MyaiNode
+//=================================================================
+
+MYAI_BENCH(node_serialize, "node/serialize") {
+	std::mt19937 rng(ctx.config().seed);
+	auto node = random_node(rng, 1, ctx.config().fanout, 1 << 20);
+	std::ostringstream out;
+	ctx.measure(256, [&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			out.str(String());
+			node->serialize(out);
+		}
+	});
+}
+
+MYAI_BENCH(node_deserialize, "node/deserialize") {
+	std::mt19937 rng(ctx.config().seed);
+	std::ostringstream out;
+	random_node(rng, 1, ctx.config().fanout, 1 << 20)->serialize(out);
+	const String data = out.str();
+	ctx.measure(256, [&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			std::istringstream in(data);
+			MyaiNode node;
+			node.deserialize(in);
+		}
+	});
+}
+
+//=================================================================
+// MyaiFileIO
+//=================================================================
+
+MYAI_BENCH(fileio_write, "fileio/write") {
+	std::filesystem::create_directories(ctx.config().data_path);
+	std::mt19937 rng(ctx.config().seed);
+	const nodeid_t node_num = 4096;
+	std::vector<MyaiNode::ptr> nodes;
+	for (nodeid_t id = 1; id <= node_num; ++id) {
+		nodes.push_back(random_node(rng, id, ctx.config().fanout, 1 << 20));
+	}
+
+	MyaiFileIO io(node_num + 1);
+	io.open(ctx.config().data_path + "/write.seg");
+	size_t pos = 0;
+	ctx.measure(256, [&](size_t n) {
+		for (size_t i = 0; i < n; ++i, pos = (pos + 1) % nodes.size()) {
+			io.write(nodes[pos]);
+		}
+	});
+}
+
+MYAI_BENCH(fileio_write_many, "fileio/write_many") {
+	std::filesystem::create_directories(ctx.config().data_path);
+	std::mt19937 rng(ctx.config().seed);
+	const nodeid_t node_num = 4096;
+	std::vector<MyaiNode::ptr> nodes;
+	for (nodeid_t id = 1; id <= node_num; ++id) {
+		nodes.push_back(random_node(rng, id, ctx.config().fanout, 1 << 20));
+	}
+
+	MyaiFileIO io(node_num + 1);
+	io.open(ctx.config().data_path + "/write_many.seg");
+	std::vector<MyaiNode::ptr> batch;
+	size_t pos = 0;
+	ctx.measure(256, [&](size_t n) {
+		batch.clear();
+		for (size_t i = 0; i < n; ++i, pos = (pos + 1) % nodes.size()) {
+			batch.push_back(nodes[pos]);
+		}
+		io.writeMany(batch);
+	});
+}
+
+MYAI_BENCH(fileio_read, "fileio/read") {
+	std::filesystem::create_directories(ctx.config().data_path);
+	std::mt19937 rng(ctx.config().seed);
+	const nodeid_t node_num = 4096;
+	const String path		= ctx.config().data_path + "/read.seg";
+	{
+		MyaiFileIO io(node_num + 1);
+		io.open(path);
+		for (nodeid_t id = 1; id <= node_num; ++id) {
+			io.write(random_node(rng, id, ctx.config().fanout, 1 << 20));
+		}
+	}
+
+	MyaiFileIO io(node_num + 1);
+	io.open(path);
+	std::uniform_int_distribution<nodeid_t> id_dist(1, node_num);
+	ctx.measure(256, [&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			auto node = MyaiNode::create(id_dist(rng), MyaiNode::NULL_WEIGHT, MyaiNode::NDS_UNDEFINED);
+			io.read(node);
+		}
+	});
+}
+
+MYAI_BENCH(fileio_read_many, "fileio/read_many") {
+	std::filesystem::create_directories(ctx.config().data_path);
+	std::mt19937 rng(ctx.config().seed);
+	const nodeid_t node_num = 4096;
+	const String path		= ctx.config().data_path + "/read.seg";
+	{
+		MyaiFileIO io(node_num + 1);
+		io.open(path);
+		for (nodeid_t id = 1; id <= node_num; ++id) {
+			io.write(random_node(rng, id, ctx.config().fanout, 1 << 20));
+		}
+	}
+
+	MyaiFileIO io(node_num + 1);
+	io.open(path);
+	std::uniform_int_distribution<nodeid_t> id_dist(1, node_num);
+	std::vector<MyaiNode::ptr> batch;
+	ctx.measure(256, [&](size_t n) {
+		batch.clear();
+		for (size_t i = 0; i < n; ++i) {
+			batch.push_back(MyaiNode::create(id_dist(rng), MyaiNode::NULL_WEIGHT, MyaiNode::NDS_UNDEFINED));
+		}
+		io.readMany(batch);
+	});
+}
+
+//=================================================================
+// IdAllocator
+//=================================================================
+
+MYAI_BENCH(idalloc_allocate, "idalloc/allocate") {
+	const size_t batch = 1024;
+	auto alloc		   = std::make_shared<IdAllocator>(1, 1 << 30);
+	std::vector<nodeid_t> ids(batch);
+	ctx.measure(batch, [&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			ids[i] = alloc->allocate();
+		}
+		// 释放一半，使下一批同时走空闲表和分片缓存
+		for (size_t i = 0; i < n; i += 2) {
+			alloc->deallocate(ids[i]);
+		}
+	});
+}
+
+MYAI_BENCH(idalloc_allocate_mt, "idalloc/allocate_mt") {
+	const size_t thread_num = std::max(2u, std::thread::hardware_concurrency());
+	const size_t per_thread = 4096;
+	auto alloc				= std::make_shared<IdAllocator>(1, 1 << 30);
+	// 每个采样是所有线程的总操作数，单个延迟为平均值
+	ctx.measure(thread_num * per_thread, [&](size_t) {
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < thread_num; ++t) {
+			threads.emplace_back([&] {
+				for (size_t i = 0; i < per_thread; ++i) {
+					alloc->allocate();
+				}
+			});
+		}
+		for (auto &thread: threads) {
+			thread.join();
+		}
+	}, 64);
+}
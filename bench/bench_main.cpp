@@ -0,0 +1,127 @@
+#include "Bench.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+MYAI_BEGIN
+namespace bench {
+
+std::atomic<uint64> g_alloc_bytes{0};
+std::atomic<uint64> g_alloc_count{0};
+
+namespace {
+
+void usage() {
+	std::cerr << "usage: myai_bench [--filter str] [--nodes n] [--fanout n] [--cycles n]\n"
+				 "                  [--min-time ms] [--min-samples n] [--seed n] [--data path] [--out file]\n";
+}
+
+String json_escape(const String &str) {
+	String out;
+	for (char c: str) {
+		if (c == '"' || c == '\\') out.push_back('\\');
+		if (c == '\n') {
+			out += "\\n";
+			continue;
+		}
+		out.push_back(c);
+	}
+	return out;
+}
+
+// 每个基准一行，字段顺序固定，便于CI直接diff
+void write_json(std::ostream &out, const BenchConfig &config, const std::vector<BenchResult> &results) {
+	out << "{\n  \"config\": {\"nodes\": " << config.nodes << ", \"fanout\": " << config.fanout
+		<< ", \"cycles\": " << config.cycles << ", \"min_time_ms\": " << config.min_time_ms
+		<< ", \"seed\": " << config.seed
+#ifdef MYAI_FLAT_EDGELIST
+		<< ", \"edgelist\": \"flat\""
+#else
+		<< ", \"edgelist\": \"map\""
+#endif
+		<< "},\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto &r = results[i];
+		out << "    {\"name\": \"" << json_escape(r.name) << "\", \"ops\": " << r.ops << ", \"seconds\": " << r.seconds
+			<< ", \"ops_per_sec\": " << r.ops_per_sec << ", \"p50_ns\": " << r.p50_ns << ", \"p99_ns\": " << r.p99_ns
+			<< ", \"bytes_per_op\": " << r.bytes_per_op << ", \"allocs_per_op\": " << r.allocs_per_op
+			<< ", \"bytes_allocated\": " << r.bytes_allocated;
+		if (!r.error.empty()) out << ", \"error\": \"" << json_escape(r.error) << "\"";
+		out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+}// namespace
+}// namespace bench
+MYAI_END
+
+void *operator new(std::size_t size) {
+	MYAI_SPACE::bench::g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	MYAI_SPACE::bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, const char **argv) {
+	using namespace MYAI_SPACE::bench;
+	BenchConfig config;
+	std::string out_path;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			usage();
+			return 1;
+		}
+		const char *val = argv[++i];
+		if (arg == "--filter") config.filter = val;
+		else if (arg == "--nodes") config.nodes = std::strtoull(val, nullptr, 10);
+		else if (arg == "--fanout") config.fanout = std::strtoull(val, nullptr, 10);
+		else if (arg == "--cycles") config.cycles = std::strtoull(val, nullptr, 10);
+		else if (arg == "--min-time") config.min_time_ms = std::strtoull(val, nullptr, 10);
+		else if (arg == "--min-samples") config.min_samples = std::strtoull(val, nullptr, 10);
+		else if (arg == "--seed") config.seed = static_cast<MYAI_SPACE::uint32>(std::strtoul(val, nullptr, 10));
+		else if (arg == "--data") config.data_path = val;
+		else if (arg == "--out") out_path = val;
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	// 注册顺序取决于链接顺序，按名称排序保证输出稳定
+	auto entries = registry();
+	std::sort(entries.begin(), entries.end(), [](const BenchEntry &a, const BenchEntry &b) { return a.name < b.name; });
+
+	std::vector<BenchResult> results;
+	for (auto &entry: entries) {
+		if (!config.filter.empty() && entry.name.find(config.filter) == std::string::npos) continue;
+		std::cerr << "running " << entry.name << "..." << std::endl;
+
+		BenchResult result;
+		result.name = entry.name;
+		std::filesystem::remove_all(config.data_path);
+		try {
+			BenchContext ctx(config, result);
+			entry.func(ctx);
+		} catch (const std::exception &e) {
+			result.error = e.what();
+		}
+		std::filesystem::remove_all(config.data_path);
+		results.push_back(result);
+	}
+
+	if (out_path.empty()) {
+		write_json(std::cout, config, results);
+	} else {
+		std::ofstream out(out_path, std::ios::out | std::ios::trunc);
+		write_json(out, config, results);
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include "CycleArena.h"
+
+#include <algorithm>
+#include <cstddef>
+
+MYAI_BEGIN
+
+namespace {
+constexpr size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+}// namespace
+
+CycleArena::CycleArena(size_t initial_size, std::pmr::memory_resource *upstream)
+	: m_upstream(upstream ? upstream : std::pmr::new_delete_resource()) {
+	if (initial_size > 0) {
+		m_data	   = static_cast<byte_t *>(m_upstream->allocate(initial_size, BLOCK_ALIGNMENT));
+		m_capacity = initial_size;
+		++m_upstream_allocations;
+	}
+}
+
+CycleArena::~CycleArena() {
+	reset();
+	if (m_data) m_upstream->deallocate(m_data, m_capacity, BLOCK_ALIGNMENT);
+}
+
+void CycleArena::reset() {
+	if (!m_overflow.empty()) {
+		for (auto &block: m_overflow) {
+			m_upstream->deallocate(block.data, block.size, block.alignment);
+		}
+		m_overflow.clear();
+
+		// 主块扩大到本轮用量，下一轮同样的负载只用主块
+		const size_t need = m_offset + m_overflow_bytes;
+		if (m_data) m_upstream->deallocate(m_data, m_capacity, BLOCK_ALIGNMENT);
+		m_capacity = std::max(need, m_capacity * 2);
+		m_data	   = static_cast<byte_t *>(m_upstream->allocate(m_capacity, BLOCK_ALIGNMENT));
+		++m_upstream_allocations;
+	}
+	m_offset		 = 0;
+	m_overflow_bytes = 0;
+}
+
+void *CycleArena::do_allocate(size_t bytes, size_t alignment) {
+	const auto base	   = reinterpret_cast<uintptr_t>(m_data);
+	const size_t begin = ((base + m_offset + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+	if (m_data && begin + bytes <= m_capacity) {
+		m_offset = begin + bytes;
+		return m_data + begin;
+	}
+
+	// 主块放不下，单独向上游分配
+	void *data = m_upstream->allocate(bytes, alignment);
+	m_overflow.push_back(Block{data, bytes, alignment});
+	m_overflow_bytes += bytes + alignment - 1;
+	++m_upstream_allocations;
+	return data;
+}
+
+MYAI_END
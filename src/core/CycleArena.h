@@ -0,0 +1,64 @@
+#ifndef MYAI_CORE_CYCLEARENA_H
+#define MYAI_CORE_CYCLEARENA_H
+
+#include "define.h"
+
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+MYAI_BEGIN
+
+/**
+ * @brief 按轮复用的单调分配器
+ * @details 在一块连续内存上移动指针分配，释放为空操作；reset 把指针移回开头。
+ *          一轮中放不下的请求从上游分配溢出块，reset 时释放溢出块，
+ *          并把主块扩大到本轮的用量，之后的轮次不再向上游分配。
+ * @note 非线程安全，每个线程使用自己的分配器
+ */
+class CycleArena : public std::pmr::memory_resource {
+public:
+	using ptr								 = std::shared_ptr<CycleArena>;
+	constexpr static size_t DEF_INITIAL_SIZE = 64ULL << 10;
+
+	explicit CycleArena(size_t initial_size = DEF_INITIAL_SIZE,
+						std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+	~CycleArena() override;
+
+	CycleArena(const CycleArena &)			  = delete;
+	CycleArena &operator=(const CycleArena &) = delete;
+
+	// 本轮的对象全部失效，指针移回开头
+	void reset();
+
+	// 本轮已分配的字节数（含溢出块）
+	size_t used() const { return m_offset + m_overflow_bytes; }
+	size_t capacity() const { return m_capacity; }
+	// 向上游分配的次数（主块+溢出块）
+	size_t upstream_allocations() const { return m_upstream_allocations; }
+
+protected:
+	void *do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void *, size_t, size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+private:
+	struct Block {
+		void *data;
+		size_t size;
+		size_t alignment;
+	};
+
+	std::pmr::memory_resource *m_upstream;
+	byte_t *m_data	  = nullptr;
+	size_t m_capacity = 0;
+	size_t m_offset	  = 0;
+
+	std::vector<Block> m_overflow;
+	size_t m_overflow_bytes		  = 0;
+	size_t m_upstream_allocations = 0;
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_CYCLEARENA_H
@@ -1,4 +1,10 @@
 #include "Edge.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
 
 
 MYAI_BEGIN
@@ -21,7 +27,29 @@ Edge &Edge::operator=(const Edge &rhs) {
 	return *this;
 }
 
-Edge &EdgeList::emplace(const value_type &val) {
+namespace {
+/**
+ * @brief 求保留边的权重绝对值下限
+ * @param mags 不小于 min_weight 的权重绝对值，会被重排
+ * @param ties 输出：绝对值等于下限的边还能保留的条数
+ */
+weight_t prune_threshold(std::vector<weight_t> &mags, size_t max_size, size_t &ties) {
+	if (max_size == 0) {
+		ties = 0;
+		return std::numeric_limits<weight_t>::infinity();
+	}
+	// 部分选择：第 max_size 大的值之前都不小于它
+	std::nth_element(mags.begin(), mags.begin() + (max_size - 1), mags.end(), std::greater<weight_t>());
+	const weight_t threshold = mags[max_size - 1];
+	const auto greater		 = std::count_if(mags.begin(), mags.begin() + (max_size - 1), [&](weight_t m) { return m > threshold; });
+	ties					 = max_size - static_cast<size_t>(greater);
+	return threshold;
+}
+}// namespace
+
+#ifndef MYAI_FLAT_EDGELIST
+
+EdgeList::reference EdgeList::emplace(const value_type &val) {
 	auto fd_rt = m_map.find(val.id);
 	if (fd_rt != m_map.end()) {
 		fd_rt->second.weight += val.weight;
@@ -51,4 +79,243 @@ void EdgeList::insert(const EdgeList &list) {
 	}
 }
 
+void EdgeList::accumulate(const EdgeList &list, weight_t scale) {
+	for (auto &[id, edge]: list.m_map) {
+		emplace(Edge{id, edge.weight * scale});
+	}
+}
+
+void EdgeList::accumulate(const Edge *edges, size_t n, weight_t scale) {
+	for (size_t i = 0; i < n; ++i) {
+		emplace(Edge{edges[i].id, edges[i].weight * scale});
+	}
+}
+
+void EdgeList::accumulate(const nodeid_t *ids, const weight_t *weights, size_t n, weight_t scale) {
+	for (size_t i = 0; i < n; ++i) {
+		emplace(Edge{ids[i], weights[i] * scale});
+	}
+}
+
+void EdgeList::scale(weight_t s) {
+	for (auto &[id, edge]: m_map) {
+		edge.weight *= s;
+	}
+}
+
+size_t EdgeList::prune(size_t max_size, weight_t min_weight, weight_t *pruned_weight) {
+	std::vector<weight_t> mags;
+	mags.reserve(m_map.size());
+	for (auto &[id, edge]: m_map) {
+		const weight_t mag = std::fabs(edge.weight);
+		if (mag >= min_weight) mags.push_back(mag);
+	}
+	if (mags.size() == m_map.size() && mags.size() <= max_size) return 0;
+
+	weight_t threshold = min_weight;
+	size_t ties		   = SIZE_MAX;
+	if (mags.size() > max_size) threshold = prune_threshold(mags, max_size, ties);
+
+	const size_t old_size = m_map.size();
+	for (auto it = m_map.begin(); it != m_map.end();) {
+		const weight_t mag = std::fabs(it->second.weight);
+		if (mag >= min_weight && (mag > threshold || (mag == threshold && ties > 0))) {
+			if (mag == threshold) --ties;
+			++it;
+			continue;
+		}
+		if (pruned_weight) *pruned_weight += mag;
+		it = m_map.erase(it);
+	}
+	return old_size - m_map.size();
+}
+
+#else
+
+EdgeList::reference EdgeList::emplace(const value_type &val) {
+	auto it		   = std::lower_bound(m_ids.begin(), m_ids.end(), val.id);
+	const auto pos = static_cast<size_t>(it - m_ids.begin());
+	if (it != m_ids.end() && *it == val.id) {
+		m_weights[pos] += val.weight;
+	} else {
+		m_ids.insert(it, val.id);
+		m_weights.insert(m_weights.begin() + pos, val.weight);
+	}
+	return reference{m_ids[pos], m_weights[pos]};
+}
+
+EdgeList::iterator EdgeList::find(const nodeid_t &key) {
+	auto it = std::lower_bound(m_ids.begin(), m_ids.end(), key);
+	if (it == m_ids.end() || *it != key) {
+		return end();
+	}
+	return {this, static_cast<size_t>(it - m_ids.begin())};
+}
+
+void EdgeList::insert(EdgeList::const_iterator first, EdgeList::const_iterator last) {
+	if (first == last) return;
+	if (first.m_list != last.m_list) {
+		for (auto it = first; it != last; ++it) {
+			emplace(it->second);
+		}
+		return;
+	}
+	const EdgeList *src = first.m_list;
+	if (src == this) {
+		// 归并会扩容，不能读取自身；同id累加即权重加倍
+		simd::scale(m_weights.data() + first.m_pos, last.m_pos - first.m_pos, 2.0f);
+		return;
+	}
+	merge(src->m_ids.data() + first.m_pos, src->m_weights.data() + first.m_pos, last.m_pos - first.m_pos, 1.0f);
+}
+
+void EdgeList::accumulate(const EdgeList &list, weight_t scale) {
+	if (&list == this) {
+		simd::scale(m_weights.data(), m_weights.size(), 1.0f + scale);
+		return;
+	}
+	merge(list.m_ids.data(), list.m_weights.data(), list.size(), scale);
+}
+
+void EdgeList::accumulate(const Edge *edges, size_t n, weight_t scale) {
+	thread_local std::vector<nodeid_t> ids;
+	thread_local std::vector<weight_t> weights;
+	ids.resize(n);
+	weights.resize(n);
+
+	bool sorted = true;
+	for (size_t i = 0; i < n; ++i) {
+		ids[i]	   = edges[i].id;
+		weights[i] = edges[i].weight;
+		if (i > 0 && ids[i] <= ids[i - 1]) sorted = false;
+	}
+	if (!sorted) {
+		for (size_t i = 0; i < n; ++i) {
+			emplace(Edge{edges[i].id, edges[i].weight * scale});
+		}
+		return;
+	}
+	merge(ids.data(), weights.data(), n, scale);
+}
+
+void EdgeList::accumulate(const nodeid_t *ids, const weight_t *weights, size_t n, weight_t scale) {
+	for (size_t i = 1; i < n; ++i) {
+		if (ids[i] <= ids[i - 1]) {
+			for (size_t j = 0; j < n; ++j) {
+				emplace(Edge{ids[j], weights[j] * scale});
+			}
+			return;
+		}
+	}
+	merge(ids, weights, n, scale);
+}
+
+void EdgeList::scale(weight_t s) {
+	simd::scale(m_weights.data(), m_weights.size(), s);
+}
+
+size_t EdgeList::prune(size_t max_size, weight_t min_weight, weight_t *pruned_weight) {
+	std::vector<weight_t> mags;
+	mags.reserve(m_weights.size());
+	for (weight_t w: m_weights) {
+		const weight_t mag = std::fabs(w);
+		if (mag >= min_weight) mags.push_back(mag);
+	}
+	if (mags.size() == m_weights.size() && mags.size() <= max_size) return 0;
+
+	weight_t threshold = min_weight;
+	size_t ties		   = SIZE_MAX;
+	if (mags.size() > max_size) threshold = prune_threshold(mags, max_size, ties);
+
+	// 原地压缩，保持id有序；同值时保留id较小的
+	size_t out = 0;
+	for (size_t i = 0; i < m_ids.size(); ++i) {
+		const weight_t mag = std::fabs(m_weights[i]);
+		if (mag >= min_weight && (mag > threshold || (mag == threshold && ties > 0))) {
+			if (mag == threshold) --ties;
+			m_ids[out]	   = m_ids[i];
+			m_weights[out] = m_weights[i];
+			++out;
+			continue;
+		}
+		if (pruned_weight) *pruned_weight += mag;
+	}
+	const size_t pruned = m_ids.size() - out;
+	m_ids.resize(out);
+	m_weights.resize(out);
+	return pruned;
+}
+
+void EdgeList::merge(const nodeid_t *ids, const weight_t *weights, size_t n, weight_t scale) {
+	if (n == 0) return;
+	const size_t size = m_ids.size();
+
+	// 追加：新id全部大于已有id
+	if (size == 0 || ids[0] > m_ids.back()) {
+		m_ids.insert(m_ids.end(), ids, ids + n);
+		m_weights.resize(size + n);
+		simd::scale_copy(m_weights.data() + size, weights, n, scale);
+		return;
+	}
+
+	// 原地累加：id集合完全相同
+	if (size == n && simd::equal_prefix(m_ids.data(), ids, n) == n) {
+		simd::axpy(m_weights.data(), weights, n, scale);
+		return;
+	}
+
+	// 一般情况：先数出新增的id，只扩容一次，再从尾部向前原地归并。
+	// 不另建输出缓冲：列表从单调分配器分配时，旧缓冲无法回收
+	size_t added = 0;
+	for (size_t i = 0, j = 0; j < n;) {
+		if (i == size || ids[j] < m_ids[i]) {
+			++added;
+			++j;
+		} else if (m_ids[i] < ids[j]) {
+			++i;
+		} else {
+			++i;
+			++j;
+		}
+	}
+
+	if (added == 0) {
+		// id 都已存在：相同id的连续段整体向量化累加
+		for (size_t i = 0, j = 0; j < n;) {
+			if (m_ids[i] < ids[j]) {
+				++i;
+				continue;
+			}
+			const size_t run = simd::equal_prefix(m_ids.data() + i, ids + j, std::min(size - i, n - j));
+			simd::axpy(m_weights.data() + i, weights + j, run, scale);
+			i += run;
+			j += run;
+		}
+		return;
+	}
+
+	m_ids.resize(size + added);
+	m_weights.resize(size + added);
+	// 新的项都写入后，[0, i) 的原有项已在原位
+	for (size_t i = size, j = n, out = size + added; j > 0;) {
+		--out;
+		if (i > 0 && m_ids[i - 1] > ids[j - 1]) {
+			--i;
+			m_ids[out]	   = m_ids[i];
+			m_weights[out] = m_weights[i];
+		} else if (i > 0 && m_ids[i - 1] == ids[j - 1]) {
+			--i;
+			--j;
+			m_ids[out]	   = m_ids[i];
+			m_weights[out] = m_weights[i] + weights[j] * scale;
+		} else {
+			--j;
+			m_ids[out]	   = ids[j];
+			m_weights[out] = weights[j] * scale;
+		}
+	}
+}
+
+#endif// !MYAI_FLAT_EDGELIST
+
 MYAI_END
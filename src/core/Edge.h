@@ -4,7 +4,9 @@
 
 #include "define.h"
 
+#include <memory_resource>
 #include <unordered_map>
+#include <vector>
 
 MYAI_BEGIN
 
@@ -29,12 +31,13 @@ struct Edge {
 
 // using EdgeList = std::unordered_map<nodeid_t, Edge>;
 
+#ifndef MYAI_FLAT_EDGELIST
 
 class EdgeList {
 public:
 	using ptr									 = std::shared_ptr<EdgeList>;
 	using value_type							 = Edge;
-	using container								 = std::unordered_map<nodeid_t, value_type>;
+	using container								 = std::pmr::unordered_map<nodeid_t, value_type>;
 	using iterator								 = container::iterator;
 	using const_iterator						 = container::const_iterator;
 	using reference								 = value_type &;
@@ -46,6 +49,8 @@ public:
 	EdgeList(const EdgeList &)					 = default;
 	EdgeList &operator=(EdgeList &&rhs) noexcept = default;
 	EdgeList &operator=(const EdgeList &rhs)	 = default;
+	// 从 resource 分配内存（如 CycleArena），拷贝出的表使用默认分配器
+	explicit EdgeList(std::pmr::memory_resource *resource) : m_map(resource) {}
 
 
 	iterator begin() { return m_map.begin(); }
@@ -54,18 +59,152 @@ public:
 	const_iterator end() const { return m_map.end(); }
 	size_t size() const { return m_map.size(); }
 	bool empty() const { return m_map.empty(); }
+	void clear() { m_map.clear(); }
+	// 估算的堆内存占用：每个元素一个哈希节点，外加桶数组
+	size_t memory_size() const { return m_map.size() * (sizeof(container::value_type) + 2 * sizeof(void *)) + m_map.bucket_count() * sizeof(void *); }
 
-	Edge &emplace(const value_type &key);
-	Edge &emplace(nodeid_t id, weight_t weight) { return emplace(value_type{id, weight}); }
+	reference emplace(const value_type &key);
+	reference emplace(nodeid_t id, weight_t weight) { return emplace(value_type{id, weight}); }
 	iterator find(const nodeid_t &key);
 	void insert(EdgeList::const_iterator first, EdgeList::const_iterator last);
 	void insert(const EdgeList &list);
 	void insert(EdgeList::ptr list) { insert(list->begin(), list->end()); }
 
+	// 将list中的权重乘以scale后累加到本表
+	void accumulate(const EdgeList &list, weight_t scale);
+	void accumulate(const Edge *edges, size_t n, weight_t scale);
+	void accumulate(const nodeid_t *ids, const weight_t *weights, size_t n, weight_t scale);
+	// 所有权重乘以s
+	void scale(weight_t s);
+	/**
+	 * @brief 只保留权重绝对值最大的 max_size 条，绝对值小于 min_weight 的边丢弃
+	 * @param pruned_weight 非空时累加被删除边的权重绝对值
+	 * @return 删除的边数
+	 */
+	size_t prune(size_t max_size, weight_t min_weight, weight_t *pruned_weight = nullptr);
+
 private:
 	container m_map;
 };
 
+#else
+
+/**
+ * @brief 按id有序的连续链接表，id与权重分开存放（结构数组）
+ * @note 通过 MYAI_FLAT_EDGELIST 在编译期启用，接口与哈希表实现一致
+ */
+class EdgeList {
+	template<bool Const>
+	class basic_iterator;
+
+public:
+	using ptr		 = std::shared_ptr<EdgeList>;
+	using value_type = Edge;
+
+	// 链接项的引用代理，可通过 weight 修改权重
+	template<typename W>
+	struct basic_reference {
+		const nodeid_t id;
+		W &weight;
+		operator Edge() const { return Edge{id, weight}; }
+	};
+	using reference								 = basic_reference<weight_t>;
+	using const_reference						 = basic_reference<const weight_t>;
+	using iterator								 = basic_iterator<false>;
+	using const_iterator						 = basic_iterator<true>;
+
+	EdgeList()									 = default;
+	~EdgeList()									 = default;
+	EdgeList(EdgeList &&)						 = default;
+	EdgeList(const EdgeList &)					 = default;
+	EdgeList &operator=(EdgeList &&rhs) noexcept = default;
+	EdgeList &operator=(const EdgeList &rhs)	 = default;
+	explicit EdgeList(std::pmr::memory_resource *resource) : m_ids(resource), m_weights(resource) {}
+
+	iterator begin() { return {this, 0}; }
+	iterator end() { return {this, size()}; }
+	const_iterator begin() const { return {this, 0}; }
+	const_iterator end() const { return {this, size()}; }
+	size_t size() const { return m_ids.size(); }
+	bool empty() const { return m_ids.empty(); }
+	// 保留容量，便于每轮复用
+	void clear() {
+		m_ids.clear();
+		m_weights.clear();
+	}
+	size_t memory_size() const { return m_ids.capacity() * sizeof(nodeid_t) + m_weights.capacity() * sizeof(weight_t); }
+
+	reference emplace(const value_type &key);
+	reference emplace(nodeid_t id, weight_t weight) { return emplace(value_type{id, weight}); }
+	iterator find(const nodeid_t &key);
+	void insert(EdgeList::const_iterator first, EdgeList::const_iterator last);
+	void insert(const EdgeList &list) { accumulate(list, 1.0f); }
+	void insert(EdgeList::ptr list) { insert(*list); }
+
+	void accumulate(const EdgeList &list, weight_t scale);
+	// edges 按id升序时走向量化归并，否则逐个插入
+	void accumulate(const Edge *edges, size_t n, weight_t scale);
+	// 列式的边（如快照中的一行），ids 升序时直接归并
+	void accumulate(const nodeid_t *ids, const weight_t *weights, size_t n, weight_t scale);
+	void scale(weight_t s);
+	size_t prune(size_t max_size, weight_t min_weight, weight_t *pruned_weight = nullptr);
+
+	const std::pmr::vector<nodeid_t> &ids() const { return m_ids; }
+	const std::pmr::vector<weight_t> &weights() const { return m_weights; }
+
+private:
+	void merge(const nodeid_t *ids, const weight_t *weights, size_t n, weight_t scale);
+
+	template<bool Const>
+	class basic_iterator {
+		friend class EdgeList;
+		using list_type = std::conditional_t<Const, const EdgeList, EdgeList>;
+		using ref_type	= std::conditional_t<Const, EdgeList::const_reference, EdgeList::reference>;
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using difference_type	= std::ptrdiff_t;
+		using value_type		= std::pair<const nodeid_t, ref_type>;
+		using reference			= value_type;
+		struct pointer {
+			value_type val;
+			value_type *operator->() { return &val; }
+		};
+
+		basic_iterator() = default;
+		basic_iterator(list_type *list, size_t pos) : m_list(list), m_pos(pos) {}
+		template<bool C = Const, typename = std::enable_if_t<C>>
+		basic_iterator(const basic_iterator<false> &it) : m_list(it.m_list), m_pos(it.m_pos) {}
+
+		reference operator*() const {
+			return {m_list->m_ids[m_pos], ref_type{m_list->m_ids[m_pos], m_list->m_weights[m_pos]}};
+		}
+		pointer operator->() const { return pointer{**this}; }
+		basic_iterator &operator++() {
+			++m_pos;
+			return *this;
+		}
+		basic_iterator operator++(int) {
+			auto tmp = *this;
+			++m_pos;
+			return tmp;
+		}
+		bool operator==(const basic_iterator &rhs) const { return m_pos == rhs.m_pos && m_list == rhs.m_list; }
+		bool operator!=(const basic_iterator &rhs) const { return !(*this == rhs); }
+
+	private:
+		friend class basic_iterator<true>;
+		list_type *m_list = nullptr;
+		size_t m_pos	  = 0;
+	};
+
+private:
+	std::pmr::vector<nodeid_t> m_ids;
+	std::pmr::vector<weight_t> m_weights;
+};
+
+#endif// !MYAI_FLAT_EDGELIST
+
 
 MYAI_END
 
@@ -0,0 +1,203 @@
+#include "GraphSnapshot.h"
+#include "MyaiDao.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+MYAI_BEGIN
+
+namespace {
+
+uint64 align_section(uint64 offset) {
+	return (offset + GraphSnapshot::SECTION_ALIGN - 1) / GraphSnapshot::SECTION_ALIGN * GraphSnapshot::SECTION_ALIGN;
+}
+
+// 补零到 offset
+void pad_to(std::ostream &out, uint64 offset) {
+	static const byte_t zeros[GraphSnapshot::SECTION_ALIGN] = {};
+	for (auto pos = static_cast<uint64>(out.tellp()); pos < offset;) {
+		const size_t n = static_cast<size_t>(std::min<uint64>(offset - pos, sizeof(zeros)));
+		out.write(zeros, static_cast<std::streamsize>(n));
+		pos += n;
+	}
+}
+
+template<typename T>
+void write_column(std::ostream &out, uint64 offset, const std::vector<T> &column) {
+	out.seekp(static_cast<std::streamoff>(offset));
+	out.write(reinterpret_cast<const byte_t *>(column.data()), static_cast<std::streamsize>(column.size() * sizeof(T)));
+}
+
+}// namespace
+
+void GraphSnapshot::open(const String &path) {
+	close();
+	// 激活时按id随机访问，关闭预读
+	if (!m_map.open(path, MappedFile::MFA_RANDOM)) MYLIB_THROW("file error: snapshot open failed.");
+
+	if (m_map.size() < sizeof(MAGIC_HEAD) + sizeof(FileHead) || std::memcmp(m_map.data(), MAGIC_HEAD, sizeof(MAGIC_HEAD)) != 0) {
+		close();
+		MYLIB_THROW("file error: snapshot is corrupted.");
+	}
+	std::memcpy(&m_head, m_map.data() + sizeof(MAGIC_HEAD), sizeof(m_head));
+	if (m_head.file_vision != FILE_VISION || m_head.head_size != sizeof(FileHead)) {
+		close();
+		MYLIB_THROW("file error: snapshot vision is not compatible.");
+	}
+
+	// 只校验各列的范围，不逐行检查
+	auto section_ok = [this](uint64 offset, uint64 count, size_t size) {
+		return offset % SECTION_ALIGN == 0 && offset <= m_head.file_size && count <= (m_head.file_size - offset) / size;
+	};
+	const bool ok = m_head.file_size == m_map.size() &&
+					section_ok(m_head.node_id_offset, m_head.node_num, sizeof(nodeid_t)) &&
+					section_ok(m_head.bias_offset, m_head.node_num, sizeof(weight_t)) &&
+					section_ok(m_head.state_offset, m_head.node_num, sizeof(MyaiNode::enum_size)) &&
+					section_ok(m_head.row_offset, m_head.node_num + 1, sizeof(uint64)) &&
+					section_ok(m_head.edge_id_offset, m_head.edge_num, sizeof(nodeid_t)) &&
+					section_ok(m_head.edge_weight_offset, m_head.edge_num, sizeof(weight_t));
+	if (!ok || rows()[0] != 0 || rows()[m_head.node_num] != m_head.edge_num) {
+		close();
+		MYLIB_THROW("file error: snapshot is corrupted.");
+	}
+
+	const nodeid_t *ids = node_ids();
+	m_dense				= m_head.node_num > 0 && ids[m_head.node_num - 1] - ids[0] + 1 == m_head.node_num;
+}
+
+void GraphSnapshot::close() noexcept {
+	m_map.close();
+	m_head	= FileHead();
+	m_dense = false;
+}
+
+size_t GraphSnapshot::find(nodeid_t id) const {
+	const size_t n = node_num();
+	if (n == 0) return npos;
+	const nodeid_t *ids = node_ids();
+	if (m_dense) {
+		return id >= ids[0] && id - ids[0] < n ? id - ids[0] : npos;
+	}
+	const nodeid_t *it = std::lower_bound(ids, ids + n, id);
+	return it != ids + n && *it == id ? static_cast<size_t>(it - ids) : npos;
+}
+
+GraphSnapshot::Row GraphSnapshot::row(size_t index) const {
+	if (index >= node_num()) MYLIB_THROW("avg error: snapshot row is out of range");
+	const uint64 begin = rows()[index], end = rows()[index + 1];
+	if (begin > end || end > edge_num()) MYLIB_THROW("file error: snapshot row is corrupted.");
+
+	Row res;
+	res.id			 = node_ids()[index];
+	res.bias		 = biases()[index];
+	res.state		 = static_cast<MyaiNode::State>(states()[index]);
+	res.link_ids	 = edge_ids() + begin;
+	res.link_weights = edge_weights() + begin;
+	res.link_num	 = static_cast<size_t>(end - begin);
+	return res;
+}
+
+bool GraphSnapshot::view(nodeid_t id, Row &row) const {
+	const size_t index = find(id);
+	if (index == npos) return false;
+	row = this->row(index);
+	return true;
+}
+
+bool GraphSnapshot::prefetch(nodeid_t id) const {
+	const size_t index = find(id);
+	if (index == npos) return false;
+	const uint64 begin = rows()[index], end = rows()[index + 1];
+	if (begin >= end || end > edge_num()) return true;
+	const size_t n = static_cast<size_t>(end - begin);
+	m_map.will_need(static_cast<size_t>(m_head.edge_id_offset + begin * sizeof(nodeid_t)), n * sizeof(nodeid_t));
+	m_map.will_need(static_cast<size_t>(m_head.edge_weight_offset + begin * sizeof(weight_t)), n * sizeof(weight_t));
+	return true;
+}
+
+size_t GraphSnapshot::save(MyaiDao &dao, const String &path) {
+	const std::vector<nodeid_t> ids = dao.ids();
+	const size_t n					= ids.size();
+
+	FileHead head;
+	head.node_num		= n;
+	head.node_id_offset = align_section(sizeof(MAGIC_HEAD) + sizeof(FileHead));
+	head.bias_offset	= align_section(head.node_id_offset + n * sizeof(nodeid_t));
+	head.state_offset	= align_section(head.bias_offset + n * sizeof(weight_t));
+	head.row_offset		= align_section(head.state_offset + n * sizeof(MyaiNode::enum_size));
+	head.edge_id_offset = align_section(head.row_offset + (n + 1) * sizeof(uint64));
+
+	std::vector<weight_t> biases(n);
+	std::vector<MyaiNode::enum_size> states(n);
+	std::vector<uint64> rows(n + 1, 0);
+
+	const String tmp_path	 = path + ".tmp";
+	const String weight_path = path + ".weights.tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::out | std::ios::trunc);
+		std::ofstream weights(weight_path, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file.is_open() || !weights.is_open()) MYLIB_THROW("file error: snapshot save failed.");
+		pad_to(file, head.edge_id_offset);
+
+		std::vector<Edge> edges;
+		std::vector<nodeid_t> row_ids;
+		std::vector<weight_t> row_weights;
+		for (size_t i = 0; i < n; ++i) {
+			edges.clear();
+			MyaiNodeView view;
+			if (dao.viewById(ids[i], view)) {
+				// 记录中的链接已按id升序
+				biases[i] = view.bias;
+				states[i] = view.state;
+				edges.assign(view.links, view.links + view.link_num);
+			} else {
+				MyaiNode::ptr node = dao.selectById(ids[i]);
+				if (node == nullptr) MYLIB_THROW("file error: node record is missing.");
+				biases[i] = node->bias();
+				states[i] = node->state();
+				for (const auto &link: node->links()) {
+					edges.push_back(link.second);
+				}
+				std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.id < b.id; });
+			}
+
+			row_ids.resize(edges.size());
+			row_weights.resize(edges.size());
+			for (size_t j = 0; j < edges.size(); ++j) {
+				row_ids[j]	   = edges[j].id;
+				row_weights[j] = edges[j].weight;
+			}
+			file.write(reinterpret_cast<const byte_t *>(row_ids.data()), static_cast<std::streamsize>(row_ids.size() * sizeof(nodeid_t)));
+			weights.write(reinterpret_cast<const byte_t *>(row_weights.data()), static_cast<std::streamsize>(row_weights.size() * sizeof(weight_t)));
+			rows[i + 1] = rows[i] + edges.size();
+		}
+		weights.close();
+		if (!weights) MYLIB_THROW("file error: snapshot save failed.");
+
+		// 权重列接在边id列之后
+		head.edge_num			= rows[n];
+		head.edge_weight_offset = align_section(head.edge_id_offset + head.edge_num * sizeof(nodeid_t));
+		head.file_size			= head.edge_weight_offset + head.edge_num * sizeof(weight_t);
+		pad_to(file, head.edge_weight_offset);
+		if (head.edge_num > 0) {
+			std::ifstream in(weight_path, std::ios::binary | std::ios::in);
+			file << in.rdbuf();
+		}
+
+		file.seekp(0);
+		file.write(MAGIC_HEAD, sizeof(MAGIC_HEAD));
+		file.write(reinterpret_cast<const byte_t *>(&head), sizeof(head));
+		write_column(file, head.node_id_offset, ids);
+		write_column(file, head.bias_offset, biases);
+		write_column(file, head.state_offset, states);
+		write_column(file, head.row_offset, rows);
+		if (!file) MYLIB_THROW("file error: snapshot save failed.");
+	}
+	std::filesystem::remove(weight_path);
+	std::filesystem::rename(tmp_path, path);
+	return n;
+}
+
+MYAI_END
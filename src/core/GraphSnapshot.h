@@ -0,0 +1,102 @@
+#ifndef MYAI_CORE_GRAPHSNAPSHOT_H
+#define MYAI_CORE_GRAPHSNAPSHOT_H
+
+#include "MappedFile.h"
+#include "MyaiNode.h"
+
+MYAI_BEGIN
+
+class MyaiDao;
+
+/**
+ * @brief 整张图的 CSR 快照
+ * @details 文件布局：魔数 | 文件头 | 各列(按 SECTION_ALIGN 对齐)
+ *          节点列：ids(升序) | bias | state | row(node_num+1项)
+ *          边列：edge_ids | edge_weights，第 i 个节点的边为 [row[i], row[i+1])，按目标id升序
+ *          打开时只映射文件并校验文件头，不逐节点反序列化
+ * @note 快照只保存链接，不保存缓冲区（与段文件中的节点记录一致）
+ */
+class GraphSnapshot {
+public:
+	using ptr							  = std::shared_ptr<GraphSnapshot>;
+	constexpr static char MAGIC_HEAD[]	  = "MYAICSR";
+	constexpr static uint32 FILE_VISION	  = 1;
+	constexpr static size_t SECTION_ALIGN = 64;
+	constexpr static size_t npos		  = static_cast<size_t>(-1);
+
+	struct FileHead {
+		uint32 file_vision		  = FILE_VISION;
+		uint32 head_size		  = sizeof(FileHead);
+		uint64 node_num			  = 0;
+		uint64 edge_num			  = 0;
+		uint64 node_id_offset	  = 0;// nodeid_t[node_num]
+		uint64 bias_offset		  = 0;// weight_t[node_num]
+		uint64 state_offset		  = 0;// MyaiNode::enum_size[node_num]
+		uint64 row_offset		  = 0;// uint64[node_num + 1]
+		uint64 edge_id_offset	  = 0;// nodeid_t[edge_num]
+		uint64 edge_weight_offset = 0;// weight_t[edge_num]
+		uint64 file_size		  = 0;
+	};
+
+	// 一个节点的只读视图，指针指向映射的文件
+	struct Row {
+		nodeid_t id					 = MyaiNode::NULL_ID;
+		weight_t bias				 = MyaiNode::NULL_WEIGHT;
+		MyaiNode::State state		 = MyaiNode::NDS_UNDEFINED;
+		const nodeid_t *link_ids	 = nullptr;
+		const weight_t *link_weights = nullptr;
+		size_t link_num				 = 0;
+	};
+
+	GraphSnapshot() = default;
+	~GraphSnapshot() { close(); }
+
+	GraphSnapshot(const GraphSnapshot &)			= delete;
+	GraphSnapshot &operator=(const GraphSnapshot &) = delete;
+
+	void open(const String &path);
+	void close() noexcept;
+	bool is_open() const { return m_map.is_open(); }
+
+	const FileHead &head() const { return m_head; }
+	size_t node_num() const { return m_head.node_num; }
+	size_t edge_num() const { return m_head.edge_num; }
+
+	// 整列访问，供全图分析使用
+	const nodeid_t *node_ids() const { return column<nodeid_t>(m_head.node_id_offset); }
+	const weight_t *biases() const { return column<weight_t>(m_head.bias_offset); }
+	const MyaiNode::enum_size *states() const { return column<MyaiNode::enum_size>(m_head.state_offset); }
+	const uint64 *rows() const { return column<uint64>(m_head.row_offset); }
+	const nodeid_t *edge_ids() const { return column<nodeid_t>(m_head.edge_id_offset); }
+	const weight_t *edge_weights() const { return column<weight_t>(m_head.edge_weight_offset); }
+
+	// 节点所在的行，不存在时返回 npos
+	size_t find(nodeid_t id) const;
+	Row row(size_t index) const;
+	bool view(nodeid_t id, Row &row) const;
+	// 预读节点的边，不等待读完
+	bool prefetch(nodeid_t id) const;
+
+	/**
+	 * @brief 把存储中的所有节点按id升序写成快照
+	 * @details 边id列直接写入目标文件，权重列先写入临时文件，最后拼接；
+	 *          写完后替换 path，写入中途失败不影响已有的快照
+	 * @return 写出的节点数
+	 */
+	static size_t save(MyaiDao &dao, const String &path);
+
+private:
+	template<typename T>
+	const T *column(uint64 offset) const {
+		return reinterpret_cast<const T *>(m_map.data() + offset);
+	}
+
+private:
+	MappedFile m_map;
+	FileHead m_head;
+	bool m_dense = false;// id连续时按下标直接定位
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_GRAPHSNAPSHOT_H
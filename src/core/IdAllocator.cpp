@@ -2,40 +2,319 @@
 // Created by HanHaocheng on 2024/12/14.
 //
 #include "IdAllocator.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
 
 MYAI_BEGIN
 
-IdAllocator::IdAllocator(std::pair<nodeid_t, nodeid_t> alloc_range, nodeid_t allocated, std::vector<nodeid_t> debris)
-	: m_range(alloc_range), m_allocated(allocated), m_debris(debris) {
+namespace {
+constexpr uint32 ID_FILE_MAGIC	 = 0x44495941;// "AYID"
+constexpr uint32 ID_FILE_VERSION = 2;// 空闲表按区间保存，版本1为逐个id
+
+// 空闲区间入栈，与栈顶相邻时合并
+void append_range(std::vector<std::pair<nodeid_t, nodeid_t>> &ranges, nodeid_t beg, nodeid_t end) {
+	if (!ranges.empty() && ranges.back().first == end) {
+		ranges.back().first = beg;
+	} else if (!ranges.empty() && ranges.back().second == beg) {
+		ranges.back().second = end;
+	} else {
+		ranges.emplace_back(beg, end);
+	}
+}
+}// namespace
+
+IdAllocator::IdAllocator(nodeid_t beg, size_t size)
+	: m_range(beg, static_cast<nodeid_t>(beg + size)),
+	  m_next(beg),
+	  m_bitmap_size((size + 63) / 64),
+	  // 栈中每项至少有一个空闲id，只有少量取空的项等待弹出
+	  m_range_chunk_num(size / RANGE_CHUNK + 2) {
+	m_bitmap = std::make_unique<std::atomic<uint64>[]>(m_bitmap_size);
+	for (size_t i = 0; i < m_bitmap_size; ++i) {
+		m_bitmap[i].store(0, std::memory_order_relaxed);
+	}
+	m_range_chunks = std::make_unique<std::atomic<FreeRange *>[]>(m_range_chunk_num);
+	for (size_t i = 0; i < m_range_chunk_num; ++i) {
+		m_range_chunks[i].store(nullptr, std::memory_order_relaxed);
+	}
 }
 
+IdAllocator::~IdAllocator() {
+	for (size_t i = 0; i < m_range_chunk_num; ++i) {
+		delete[] m_range_chunks[i].load(std::memory_order_relaxed);
+	}
+}
 
 nodeid_t IdAllocator::allocate() {
-	if (!m_debris.empty()) {
-		nodeid_t id = m_debris.back();
-		m_debris.pop_back();
-		return id;
+	if (head_index(m_free_head.load(std::memory_order_relaxed)) != 0) {
+		const nodeid_t id = pop_free();
+		if (id != 0) return id;
 	}
 
-	if (m_allocated == m_range.second) {
-		return 0;
+	CacheSlot &sd = slot();
+	uint64 val	  = sd.range.load(std::memory_order_acquire);
+	while (true) {
+		// 从分片缓存取id
+		while (slot_next(val) < slot_end(val)) {
+			const nodeid_t id = slot_next(val);
+			if (!sd.range.compare_exchange_weak(val, pack(id + 1, slot_end(val)), std::memory_order_acq_rel)) continue;
+			if (set_bit(id)) return id;
+			val = sd.range.load(std::memory_order_acquire);
+		}
+
+		// 缓存用尽，从全局指针取一块
+		nodeid_t blk = m_next.load(std::memory_order_relaxed), end;
+		do {
+			if (blk >= m_range.second) {
+				const nodeid_t id = pop_free();
+				if (id == 0) MYLIB_THROW("id error: id allocate out of range");
+				return id;
+			}
+			end = static_cast<nodeid_t>(std::min<size_t>(size_t(blk) + DEF_CACHE_BLOCK, m_range.second));
+		} while (!m_next.compare_exchange_weak(blk, end, std::memory_order_relaxed));
+
+		// 其他线程已先填充时，这一块归还空闲表
+		if (!sd.range.compare_exchange_strong(val, pack(blk + 1, end), std::memory_order_acq_rel)) {
+			push_free(blk + 1, end);
+		}
+		if (set_bit(blk)) return blk;
+		val = sd.range.load(std::memory_order_acquire);
 	}
-	return ++m_allocated;
 }
 
 nodeid_t IdAllocator::allocate(size_t size) {
-	nodeid_t id = m_allocated;
-	m_allocated += size;
-	return id;
+	nodeid_t blk = m_next.load(std::memory_order_relaxed);
+	do {
+		if (size_t(blk) + size > m_range.second) MYLIB_THROW("id error: id allocate out of range");
+	} while (!m_next.compare_exchange_weak(blk, static_cast<nodeid_t>(blk + size), std::memory_order_relaxed));
+
+	for (size_t i = 0; i < size; ++i) {
+		set_bit(static_cast<nodeid_t>(blk + i));
+	}
+	return blk;
 }
 
 bool IdAllocator::deallocate(nodeid_t id) {
-	if (id > m_range.second) {
+	if (!clear_bit(id)) {
 		return false;
 	}
-	m_debris.push_back(id);
+	push_free(id, id + 1);
+	return true;
+}
+
+void IdAllocator::occupy(nodeid_t id) {
+	if (id < m_range.first || id >= m_range.second) return;
+	set_bit(id);
+
+	// id超出全局指针时，中间跳过的id放入空闲表
+	nodeid_t next = m_next.load(std::memory_order_relaxed);
+	while (id >= next) {
+		if (m_next.compare_exchange_weak(next, id + 1, std::memory_order_relaxed)) {
+			push_free(next, id);
+			break;
+		}
+	}
+}
+
+void IdAllocator::save(const String &path) {
+	for (auto &sd: m_slots) {
+		const uint64 val = sd.range.exchange(0, std::memory_order_acq_rel);
+		if (slot_next(val) < slot_end(val)) push_free(slot_next(val), slot_end(val));
+	}
+
+	// 整个空闲栈先取下再遍历，写完接回；取下期间分配从全局指针取
+	uint64 head = m_free_head.load(std::memory_order_acquire);
+	while (!m_free_head.compare_exchange_weak(head, pack_head(head_tag(head) + 1, 0), std::memory_order_acq_rel)) {}
+	std::vector<std::pair<nodeid_t, nodeid_t>> free_ranges;
+	uint32 last = 0;
+	for (uint32 i = head_index(head); i != 0; i = free_range(i).next.load(std::memory_order_relaxed)) {
+		const uint64 val = free_range(i).range.load(std::memory_order_acquire);
+		if (slot_next(val) < slot_end(val)) free_ranges.emplace_back(slot_next(val), slot_end(val));
+		last = i;
+	}
+	// 文件中栈顶在最后
+	std::reverse(free_ranges.begin(), free_ranges.end());
+	const nodeid_t next = m_next.load(std::memory_order_relaxed);
+	if (last != 0) push_stack(m_free_head, head_index(head), last);
+
+	const String tmp_path = path + ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file.is_open()) MYLIB_THROW("file error: id allocator save failed.");
+
+		const uint64 free_n = free_ranges.size();
+		file.write(reinterpret_cast<const char *>(&ID_FILE_MAGIC), sizeof(ID_FILE_MAGIC));
+		file.write(reinterpret_cast<const char *>(&ID_FILE_VERSION), sizeof(ID_FILE_VERSION));
+		file.write(reinterpret_cast<const char *>(&m_range.first), sizeof(m_range.first));
+		file.write(reinterpret_cast<const char *>(&m_range.second), sizeof(m_range.second));
+		file.write(reinterpret_cast<const char *>(&next), sizeof(next));
+		file.write(reinterpret_cast<const char *>(&free_n), sizeof(free_n));
+		file.write(reinterpret_cast<const char *>(free_ranges.data()), free_n * sizeof(free_ranges[0]));
+		for (size_t i = 0; i < m_bitmap_size; ++i) {
+			const uint64 word = m_bitmap[i].load(std::memory_order_relaxed);
+			file.write(reinterpret_cast<const char *>(&word), sizeof(word));
+		}
+		if (!file) MYLIB_THROW("file error: id allocator save failed.");
+	}
+	// 替换前先落盘临时文件，替换后再落盘所在目录，断电后不会留下空文件或旧文件
+	if (!MappedFile::sync_file(tmp_path)) MYLIB_THROW("file error: id allocator sync failed.");
+	std::filesystem::rename(tmp_path, path);
+	const auto dir = std::filesystem::absolute(path).parent_path();
+	MappedFile::sync_file(dir.string());
+}
+
+bool IdAllocator::load(const String &path) {
+	m_path = path;
+	std::ifstream file(path, std::ios::binary | std::ios::in);
+	if (!file.is_open()) return false;
+
+	uint32 magic = 0, version = 0;
+	std::pair<nodeid_t, nodeid_t> range;
+	nodeid_t next = 0;
+	uint64 free_n = 0;
+	file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char *>(&version), sizeof(version));
+	file.read(reinterpret_cast<char *>(&range.first), sizeof(range.first));
+	file.read(reinterpret_cast<char *>(&range.second), sizeof(range.second));
+	file.read(reinterpret_cast<char *>(&next), sizeof(next));
+	file.read(reinterpret_cast<char *>(&free_n), sizeof(free_n));
+	if (!file || magic != ID_FILE_MAGIC || (version != 1 && version != ID_FILE_VERSION)) MYLIB_THROW("file error: id allocator file is corrupted.");
+	if (range != m_range) MYLIB_THROW("file error: id allocator range is not match.");
+	// 空闲项不会超过范围内的id数
+	if (free_n > size_t(m_range.second - m_range.first)) MYLIB_THROW("file error: id allocator file is corrupted.");
+
+	std::vector<std::pair<nodeid_t, nodeid_t>> free_ranges;
+	if (version == ID_FILE_VERSION) {
+		free_ranges.resize(free_n);
+		file.read(reinterpret_cast<char *>(free_ranges.data()), free_n * sizeof(free_ranges[0]));
+	} else {
+		// 版本1逐个保存，按原出栈顺序转换为区间
+		std::vector<nodeid_t> free_ids(free_n);
+		file.read(reinterpret_cast<char *>(free_ids.data()), free_n * sizeof(nodeid_t));
+		for (nodeid_t id: free_ids) {
+			append_range(free_ranges, id, id + 1);
+		}
+	}
+	std::vector<uint64> bitmap(m_bitmap_size);
+	file.read(reinterpret_cast<char *>(bitmap.data()), m_bitmap_size * sizeof(uint64));
+	if (!file) MYLIB_THROW("file error: id allocator file is corrupted.");
+
+	for (auto &sd: m_slots) {
+		sd.range.store(0, std::memory_order_relaxed);
+	}
+	for (size_t i = 0; i < m_bitmap_size; ++i) {
+		m_bitmap[i].store(bitmap[i], std::memory_order_relaxed);
+	}
+	m_next.store(next, std::memory_order_relaxed);
+	// 不与分配并发，栈项表从头重新使用
+	m_free_head.store(0, std::memory_order_relaxed);
+	m_pool_head.store(0, std::memory_order_relaxed);
+	m_range_used.store(0, std::memory_order_relaxed);
+	for (auto &[beg, end]: free_ranges) {
+		if (beg >= end) continue;
+		const uint32 index = new_range();
+		free_range(index).range.store(pack(beg, end), std::memory_order_relaxed);
+		push_stack(m_free_head, index, index);
+	}
 	return true;
 }
 
+IdAllocator::CacheSlot &IdAllocator::slot() {
+	thread_local const size_t s_hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+	return m_slots[s_hash % CACHE_SLOT_NUM];
+}
+
+bool IdAllocator::set_bit(nodeid_t id) {
+	const size_t off  = id - m_range.first;
+	const uint64 mask = uint64(1) << (off % 64);
+	return !(m_bitmap[off / 64].fetch_or(mask, std::memory_order_acq_rel) & mask);
+}
+
+bool IdAllocator::clear_bit(nodeid_t id) {
+	if (id < m_range.first || id >= m_range.second) return false;
+	const size_t off  = id - m_range.first;
+	const uint64 mask = uint64(1) << (off % 64);
+	return m_bitmap[off / 64].fetch_and(~mask, std::memory_order_acq_rel) & mask;
+}
+
+IdAllocator::FreeRange &IdAllocator::free_range(uint32 index) const {
+	return m_range_chunks[(index - 1) / RANGE_CHUNK].load(std::memory_order_acquire)[(index - 1) % RANGE_CHUNK];
+}
+
+uint32 IdAllocator::new_range() {
+	uint64 head = m_pool_head.load(std::memory_order_acquire);
+	while (head_index(head) != 0) {
+		const uint32 next = free_range(head_index(head)).next.load(std::memory_order_relaxed);
+		if (m_pool_head.compare_exchange_weak(head, pack_head(head_tag(head) + 1, next), std::memory_order_acq_rel)) {
+			return head_index(head);
+		}
+	}
+
+	const uint32 index = m_range_used.fetch_add(1, std::memory_order_relaxed) + 1;
+	const size_t chunk = (index - 1) / RANGE_CHUNK;
+	if (chunk >= m_range_chunk_num) MYLIB_THROW("id error: free range table is full");
+	if (m_range_chunks[chunk].load(std::memory_order_acquire) == nullptr) {
+		// 多个线程同时分配同一块时只保留一个
+		auto *items			= new FreeRange[RANGE_CHUNK];
+		FreeRange *expected = nullptr;
+		if (!m_range_chunks[chunk].compare_exchange_strong(expected, items, std::memory_order_acq_rel)) delete[] items;
+	}
+	return index;
+}
+
+void IdAllocator::push_stack(std::atomic<uint64> &head, uint32 first, uint32 last) {
+	uint64 top = head.load(std::memory_order_relaxed);
+	do {
+		free_range(last).next.store(head_index(top), std::memory_order_relaxed);
+	} while (!head.compare_exchange_weak(top, pack_head(head_tag(top) + 1, first), std::memory_order_acq_rel));
+}
+
+nodeid_t IdAllocator::pop_free() {
+	uint64 head = m_free_head.load(std::memory_order_acquire);
+	while (head_index(head) != 0) {
+		FreeRange &top = free_range(head_index(head));
+		uint64 val	   = top.range.load(std::memory_order_acquire);
+		if (slot_next(val) < slot_end(val)) {
+			// 从栈顶区间的开头取，使小id先被取出；回放时可能已被占用
+			const nodeid_t id = slot_next(val);
+			if (top.range.compare_exchange_weak(val, pack(id + 1, slot_end(val)), std::memory_order_acq_rel) && set_bit(id)) return id;
+		} else if (m_free_head.compare_exchange_weak(head, pack_head(head_tag(head) + 1, top.next.load(std::memory_order_relaxed)), std::memory_order_acq_rel)) {
+			// 取空的项弹出后回收，取空的区间不会再被扩展
+			push_stack(m_pool_head, head_index(head), head_index(head));
+		}
+		head = m_free_head.load(std::memory_order_acquire);
+	}
+	return 0;
+}
+
+void IdAllocator::push_free(nodeid_t beg, nodeid_t end) {
+	if (beg >= end) return;
+	// 与栈顶区间相邻时直接扩展；取空的区间可能正被弹出，不扩展
+	const uint64 head = m_free_head.load(std::memory_order_acquire);
+	if (head_index(head) != 0) {
+		auto &top  = free_range(head_index(head)).range;
+		uint64 val = top.load(std::memory_order_acquire);
+		while (slot_next(val) < slot_end(val)) {
+			uint64 merged;
+			if (slot_next(val) == end) {
+				merged = pack(beg, slot_end(val));
+			} else if (slot_end(val) == beg) {
+				merged = pack(slot_next(val), end);
+			} else {
+				break;
+			}
+			if (top.compare_exchange_weak(val, merged, std::memory_order_acq_rel)) return;
+		}
+	}
+
+	const uint32 index = new_range();
+	free_range(index).range.store(pack(beg, end), std::memory_order_release);
+	push_stack(m_free_head, index, index);
+}
 
 MYAI_END
@@ -7,32 +7,108 @@
 
 #include "define.h"
 
-#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <vector>
 
 MYAI_BEGIN
+
+/**
+ * @brief 节点id分配器
+ * @details 全局原子指针按块分配，各线程从分片缓存中取id，无需加锁；
+ *          已分配的id记录在位图中，isAllocate 为O(1)；
+ *          释放或跳过的id按区间进入空闲栈，分配时优先复用。空闲栈是带标记的无锁栈，
+ *          栈项从分块的表中取用，出栈只在栈顶区间取空后发生，分配和释放都不加锁。
+ *          状态可保存到文件，重启时直接加载。
+ * @note 位图按范围大小分配，每个id占1位；load 不能与分配、释放并发
+ */
 class IdAllocator {
 public:
-	using ptr = std::shared_ptr<IdAllocator>;
-	IdAllocator(nodeid_t beg, size_t size)
-		: m_range(beg, beg + size), m_allocated(beg), m_debris() {
-	}
-	IdAllocator(std::pair<nodeid_t, nodeid_t> alloc_range, nodeid_t allocated, std::vector<nodeid_t> debris);
+	using ptr								= std::shared_ptr<IdAllocator>;
+	constexpr static size_t DEF_CACHE_BLOCK = 64;
+	constexpr static size_t CACHE_SLOT_NUM	= 16;
+
+	IdAllocator(nodeid_t beg, size_t size);
+	~IdAllocator();
+
+	IdAllocator(const IdAllocator &)			= delete;
+	IdAllocator &operator=(const IdAllocator &) = delete;
 
+	// 分配一个id，用尽时抛出异常
 	nodeid_t allocate();
+	// 分配一段连续的id，返回首个id
 	nodeid_t allocate(size_t size);
 
 	bool deallocate(nodeid_t id);
+	// 标记id已被占用（日志回放时使用）
+	void occupy(nodeid_t id);
 
-	bool isAllocate(nodeid_t id) {
-		return id >= m_range.first && id < m_range.second && id <= m_allocated &&
-			   std::find(m_debris.begin(), m_debris.end(), id) == m_debris.end();
+	bool isAllocate(nodeid_t id) const {
+		if (id < m_range.first || id >= m_range.second) return false;
+		const size_t off = id - m_range.first;
+		return (m_bitmap[off / 64].load(std::memory_order_acquire) >> (off % 64)) & 1;
 	}
 
+	/**
+	 * @brief 保存状态到文件
+	 * @details 分片缓存中未取出的id先归还到空闲表；写入临时文件并落盘后再替换
+	 */
+	void save(const String &path);
+	// 保存到 load 时使用的文件，未加载过时不做任何事
+	void save() {
+		if (!m_path.empty()) save(m_path);
+	}
+	// 从文件加载状态并记住该路径，文件不存在时返回false
+	bool load(const String &path);
+
 private:
+	struct alignas(64) CacheSlot {
+		std::atomic<uint64> range{0};// 高32位为下一个id，低32位为结束id
+	};
+
+	constexpr static uint64 pack(nodeid_t next, nodeid_t end) { return (uint64(next) << 32) | end; }
+	constexpr static nodeid_t slot_next(uint64 val) { return static_cast<nodeid_t>(val >> 32); }
+	constexpr static nodeid_t slot_end(uint64 val) { return static_cast<nodeid_t>(val); }
+
+	// 空闲栈的项，编号从1开始，0表示空
+	struct FreeRange {
+		std::atomic<uint64> range{0};// 同 CacheSlot
+		std::atomic<uint32> next{0}; // 栈中下一项的编号
+	};
+	constexpr static size_t RANGE_CHUNK = 1024;// 栈项表每块的项数
+
+	// 栈顶：高32位为标记，每次修改加1，避免ABA；低32位为栈顶编号
+	constexpr static uint64 pack_head(uint32 tag, uint32 index) { return (uint64(tag) << 32) | index; }
+	constexpr static uint32 head_tag(uint64 head) { return static_cast<uint32>(head >> 32); }
+	constexpr static uint32 head_index(uint64 head) { return static_cast<uint32>(head); }
+
+	CacheSlot &slot();
+	FreeRange &free_range(uint32 index) const;
+	// 取一个栈项：先取回收的，没有时从表中新取
+	uint32 new_range();
+	// 把 first 到 last 的一串项压栈，last.next 被改写
+	void push_stack(std::atomic<uint64> &head, uint32 first, uint32 last);
+
+	// 设置占用位，返回之前是否未被占用
+	bool set_bit(nodeid_t id);
+	bool clear_bit(nodeid_t id);
+
+	nodeid_t pop_free();
+	void push_free(nodeid_t beg, nodeid_t end);
+
+private:
+	String m_path;
 	std::pair<nodeid_t, nodeid_t> m_range;
-	nodeid_t m_allocated;
-	std::vector<nodeid_t> m_debris;
+	std::atomic<nodeid_t> m_next;// 全局分配指针
+	std::unique_ptr<std::atomic<uint64>[]> m_bitmap;
+	size_t m_bitmap_size;
+	CacheSlot m_slots[CACHE_SLOT_NUM];
+
+	std::unique_ptr<std::atomic<FreeRange *>[]> m_range_chunks;// 栈项表，按需分配
+	size_t m_range_chunk_num;
+	std::atomic<uint32> m_range_used{0};// 已从表中取过的项数
+	std::atomic<uint64> m_free_head{0}; // 空闲区间栈，区间为 [next, end)
+	std::atomic<uint64> m_pool_head{0}; // 取空后回收的项
 };
 
 MYAI_END
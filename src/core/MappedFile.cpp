@@ -0,0 +1,129 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+
+#ifdef MYLIB_WINDOWS
+#include <windows.h>
+#elif MYLIB_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MYAI_BEGIN
+
+bool MappedFile::open(const String &path, Advice advice) {
+	return map(path, 0, false, advice);
+}
+
+bool MappedFile::open_writable(const String &path, size_t length, Advice advice) {
+	return length > 0 && map(path, length, true, advice);
+}
+
+bool MappedFile::map(const String &path, size_t length, bool writable, Advice advice) {
+	close();
+#ifdef MYLIB_WINDOWS
+	const DWORD flags = advice == MFA_RANDOM ? FILE_FLAG_RANDOM_ACCESS : advice == MFA_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+	HANDLE file		  = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+									FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, flags, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || static_cast<uint64>(size.QuadPart) < length) {
+		CloseHandle(file);
+		return false;
+	}
+	if (length == 0) length = static_cast<size_t>(size.QuadPart);
+	HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+										static_cast<DWORD>(uint64(length) >> 32), static_cast<DWORD>(length), NULL);
+	CloseHandle(file);
+	if (mapping == NULL) return false;
+	m_data = static_cast<byte_t *>(MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, length));
+	if (m_data == nullptr) {
+		CloseHandle(mapping);
+		return false;
+	}
+	m_handle = mapping;
+#elif MYLIB_LINUX
+	int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st {};
+	if (fstat(fd, &st) != 0 || st.st_size == 0 || static_cast<uint64>(st.st_size) < length) {
+		::close(fd);
+		return false;
+	}
+	if (length == 0) length = static_cast<size_t>(st.st_size);
+	void *addr = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED) return false;
+	if (advice == MFA_RANDOM) madvise(addr, length, MADV_RANDOM);
+	else if (advice == MFA_SEQUENTIAL) madvise(addr, length, MADV_SEQUENTIAL);
+	m_data = static_cast<byte_t *>(addr);
+#endif
+	m_size	   = length;
+	m_writable = writable;
+	return m_data != nullptr;
+}
+
+void MappedFile::will_need(size_t offset, size_t length) const noexcept {
+	if (!m_data || offset >= m_size) return;
+	length = std::min(length, m_size - offset);
+#ifdef MYLIB_WINDOWS
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range{m_data + offset, length};
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#elif MYLIB_LINUX
+	// madvise 要求起始地址按页对齐
+	static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t begin			  = offset / page_size * page_size;
+	madvise(m_data + begin, offset + length - begin, MADV_WILLNEED);
+#endif
+}
+
+bool MappedFile::sync() const noexcept {
+	if (!m_data || !m_writable) return true;
+#ifdef MYLIB_WINDOWS
+	return FlushViewOfFile(m_data, m_size) != 0;
+#elif MYLIB_LINUX
+	return msync(m_data, m_size, MS_SYNC) == 0;
+#else
+	return true;
+#endif
+}
+
+bool MappedFile::sync_file(const String &path) noexcept {
+#ifdef MYLIB_WINDOWS
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+							  FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	const bool ok = FlushFileBuffers(file) != 0;
+	CloseHandle(file);
+	return ok;
+#elif MYLIB_LINUX
+	// fsync 作用于文件本身，只读打开的描述符也可以
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	const bool ok = fdatasync(fd) == 0;
+	::close(fd);
+	return ok;
+#else
+	return true;
+#endif
+}
+
+void MappedFile::close() noexcept {
+	if (!m_data) return;
+#ifdef MYLIB_WINDOWS
+	UnmapViewOfFile(m_data);
+	CloseHandle(static_cast<HANDLE>(m_handle));
+#elif MYLIB_LINUX
+	munmap(m_data, m_size);
+#endif
+	m_data	   = nullptr;
+	m_size	   = 0;
+	m_writable = false;
+	m_handle   = nullptr;
+}
+
+MYAI_END
@@ -0,0 +1,60 @@
+#ifndef MYAI_CORE_MAPPEDFILE_H
+#define MYAI_CORE_MAPPEDFILE_H
+
+#include "define.h"
+
+MYAI_BEGIN
+
+/**
+ * @brief 文件的内存映射
+ * @details 默认只读映射整个文件；也可以读写映射文件开头的一段（如段文件的索引区）
+ */
+class MappedFile {
+public:
+	enum Advice {
+		MFA_NORMAL,
+		MFA_RANDOM,	   // 随机访问，关闭预读
+		MFA_SEQUENTIAL,// 顺序访问，加大预读
+	};
+
+	MappedFile() = default;
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile &)			  = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	// 文件不存在或为空时返回false
+	bool open(const String &path, Advice advice = MFA_NORMAL);
+	/**
+	 * @brief 读写映射文件开头的 length 字节，修改直接写回文件
+	 * @note 文件长度不足 length 时返回false，调用方应先扩展文件
+	 */
+	bool open_writable(const String &path, size_t length, Advice advice = MFA_NORMAL);
+	void close() noexcept;
+
+	bool is_open() const { return m_data != nullptr; }
+	bool is_writable() const { return m_writable; }
+	const byte_t *data() const { return m_data; }
+	byte_t *mutable_data() const { return m_writable ? m_data : nullptr; }
+	size_t size() const { return m_size; }
+	// 建议系统预读 [offset, offset+length)，不等待读完
+	void will_need(size_t offset, size_t length) const noexcept;
+	// 读写映射的修改同步写到磁盘，返回是否成功；只读映射直接返回true
+	bool sync() const noexcept;
+
+	// 把文件（或目录项）已写入系统缓存的内容同步到磁盘，返回是否成功
+	static bool sync_file(const String &path) noexcept;
+
+private:
+	bool map(const String &path, size_t length, bool writable, Advice advice);
+
+private:
+	byte_t *m_data	= nullptr;
+	size_t m_size	= 0;
+	bool m_writable = false;
+	void *m_handle	= nullptr;// windows 下的映射句柄
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_MAPPEDFILE_H
@@ -0,0 +1,197 @@
+#include "MyaiCache.h"
+
+#include <iostream>
+
+MYAI_BEGIN
+
+MyaiCache::MyaiCache(MyaiDao::ptr dao, size_t memory_budget, size_t shard_num, MyaiFlusher::ptr flusher)
+	: m_dao(dao),
+	  m_flusher(flusher),
+	  m_memory_budget(memory_budget),
+	  m_shard_budget(memory_budget / std::max<size_t>(shard_num, 1)),
+	  m_shards(std::max<size_t>(shard_num, 1)) {
+}
+
+MyaiNode::ptr MyaiCache::get(nodeid_t id) {
+	Shard &sd = shard(id);
+	{
+		std::lock_guard<std::mutex> lock(sd.mutex);
+		auto fd_rt = sd.map.find(id);
+		if (fd_rt != sd.map.end()) {
+			auto it = fd_rt->second;
+			hit(sd, it);
+			return it->node->m_state == MyaiNode::NDS_DESTROY ? nullptr : it->node;
+		}
+	}
+
+	++m_misses;
+	// 尚在写回队列中的节点直接取回，避免读到旧数据
+	MyaiNode::ptr node = m_flusher ? m_flusher->reclaim(id) : nullptr;
+	if (node != nullptr) {
+		if (node->m_state == MyaiNode::NDS_DESTROY) return nullptr;
+	} else {
+		node = m_dao->selectById(id);
+		if (node == nullptr) return nullptr;
+		node->m_state = MyaiNode::NDS_SAVE;
+	}
+
+	std::lock_guard<std::mutex> lock(sd.mutex);
+	auto fd_rt = sd.map.find(id);
+	if (fd_rt != sd.map.end()) {
+		// 加载期间已被其他线程放入
+		return fd_rt->second->node;
+	}
+	insert(sd, node);
+	return node;
+}
+
+size_t MyaiCache::load(const std::vector<nodeid_t> &ids) {
+	std::vector<nodeid_t> missing;
+	std::vector<MyaiNode::ptr> nodes;
+	for (nodeid_t id: ids) {
+		if (contains(id)) continue;
+		++m_misses;
+		MyaiNode::ptr node = m_flusher ? m_flusher->reclaim(id) : nullptr;
+		if (node != nullptr) {
+			if (node->m_state != MyaiNode::NDS_DESTROY) nodes.push_back(std::move(node));
+		} else {
+			missing.push_back(id);
+		}
+	}
+	if (!missing.empty()) {
+		for (auto &node: m_dao->selectMany(missing)) {
+			if (node == nullptr) continue;
+			node->m_state = MyaiNode::NDS_SAVE;
+			nodes.push_back(std::move(node));
+		}
+	}
+
+	size_t count = 0;
+	for (auto &node: nodes) {
+		Shard &sd = shard(node->id());
+		std::lock_guard<std::mutex> lock(sd.mutex);
+		// 加载期间已被其他线程放入
+		if (sd.map.find(node->id()) != sd.map.end()) continue;
+		insert(sd, std::move(node));
+		++count;
+	}
+	return count;
+}
+
+void MyaiCache::put(MyaiNode::ptr node) {
+	if (!node) MYLIB_THROW("avg error:avg is nullptr");
+	Shard &sd = shard(node->id());
+	std::lock_guard<std::mutex> lock(sd.mutex);
+	auto fd_rt = sd.map.find(node->id());
+	if (fd_rt != sd.map.end()) {
+		sd.bytes -= fd_rt->second->bytes;
+		sd.lru.erase(fd_rt->second);
+		sd.map.erase(fd_rt);
+	}
+	insert(sd, node);
+}
+
+void MyaiCache::hit(Shard &sd, std::list<Entry>::iterator it) {
+	sd.lru.splice(sd.lru.begin(), sd.lru, it);
+
+	// 节点可能在缓存外被修改，重新计算占用
+	const size_t bytes = it->node->memory_size();
+	sd.bytes		   = sd.bytes - it->bytes + bytes;
+	it->bytes		   = bytes;
+	++m_hits;
+}
+
+bool MyaiCache::contains(nodeid_t id) const {
+	Shard &sd = shard(id);
+	std::lock_guard<std::mutex> lock(sd.mutex);
+	return sd.map.find(id) != sd.map.end();
+}
+
+MyaiCache::~MyaiCache() {
+	try {
+		flush();
+	} catch (const std::exception &e) {
+		// 析构时不能抛出，写回失败只能记录
+		std::cerr << "cache error: write back failed on destroy: " << e.what() << std::endl;
+	}
+}
+
+void MyaiCache::flush() {
+	for (auto &sd: m_shards) {
+		std::lock_guard<std::mutex> lock(sd.mutex);
+		for (auto it = sd.lru.begin(); it != sd.lru.end();) {
+			// 入队后节点可能正被写回线程修改，写回前先取状态
+			const bool destroyed = it->node->m_state == MyaiNode::NDS_DESTROY;
+			write_back(it->node);
+			if (destroyed) {
+				sd.bytes -= it->bytes;
+				sd.map.erase(it->node->id());
+				it = sd.lru.erase(it);
+				continue;
+			}
+			++it;
+		}
+	}
+	if (m_flusher) m_flusher->flush();
+}
+
+MyaiCache::Statistics MyaiCache::statistics() const {
+	return Statistics{m_hits.load(), m_misses.load(), m_evictions.load(), m_writebacks.load()};
+}
+
+size_t MyaiCache::memory_size() const {
+	size_t bytes = 0;
+	for (auto &sd: m_shards) {
+		std::lock_guard<std::mutex> lock(sd.mutex);
+		bytes += sd.bytes;
+	}
+	return bytes;
+}
+
+void MyaiCache::insert(Shard &shard, MyaiNode::ptr node) {
+	const size_t bytes = node->memory_size();
+	shard.lru.push_front(Entry{node, bytes});
+	shard.map.emplace(node->id(), shard.lru.begin());
+	shard.bytes += bytes;
+	evict(shard);
+}
+
+void MyaiCache::evict(Shard &shard) {
+	// 从最久未使用的一端淘汰，跳过仍被外部持有或缓冲区未整理的节点
+	auto it = shard.lru.end();
+	while (shard.bytes > m_shard_budget && it != shard.lru.begin()) {
+		--it;
+		if (it->node.use_count() > 1 || !it->node->buffer().empty()) continue;
+
+		write_back(it->node);
+		shard.bytes -= it->bytes;
+		shard.map.erase(it->node->id());
+		it = shard.lru.erase(it);
+		++m_evictions;
+	}
+}
+
+void MyaiCache::write_back(MyaiNode::ptr node) {
+	if (m_dao->isReadOnly()) return;
+
+	if (m_flusher) {
+		if (node->is_dirty() || node->m_state == MyaiNode::NDS_DESTROY) {
+			m_flusher->enqueue(node);
+			++m_writebacks;
+		}
+		return;
+	}
+
+	if (node->m_state == MyaiNode::NDS_DESTROY) {
+		m_dao->deleteById(node->id());
+		++m_writebacks;
+		return;
+	}
+	if (node->is_dirty()) {
+		m_dao->updata(node);
+		node->m_state = MyaiNode::NDS_SAVE;
+		++m_writebacks;
+	}
+}
+
+MYAI_END
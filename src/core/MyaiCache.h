@@ -0,0 +1,115 @@
+#ifndef MYAI_CORE_MYAICACHE_H
+#define MYAI_CORE_MYAICACHE_H
+
+#include "MyaiDao.h"
+#include "MyaiFlusher.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+MYAI_BEGIN
+
+/**
+ * @brief 位于 MyaiDao 之前的节点缓存
+ * @details 按id分片，每个分片独立加锁并按LRU淘汰；
+ *          状态不是 NDS_SAVE 的节点视为脏节点，淘汰时写回，
+ *          NDS_DESTROY 的节点淘汰时从存储中删除。
+ *          仍被外部持有的节点不会被淘汰。
+ */
+class MyaiCache {
+public:
+	using ptr									= std::shared_ptr<MyaiCache>;
+	constexpr static size_t DEF_MEMORY_BUDGET	= 256ULL << 20;
+	constexpr static size_t DEF_SHARD_NUM		= 16;
+
+	struct Statistics {
+		uint64 hits		  = 0;
+		uint64 misses	  = 0;
+		uint64 evictions  = 0;
+		uint64 writebacks = 0;
+	};
+
+	MyaiCache(MyaiDao::ptr dao, size_t memory_budget = DEF_MEMORY_BUDGET, size_t shard_num = DEF_SHARD_NUM,
+			  MyaiFlusher::ptr flusher = nullptr);
+	~MyaiCache();
+
+	// 获取节点，未命中时从存储加载
+	MyaiNode::ptr get(nodeid_t id);
+	/**
+	 * @brief 批量加载未缓存的节点
+	 * @details 先从写回队列取回，其余一次交给 MyaiDao::selectMany
+	 * @return 新放入缓存的节点数
+	 */
+	size_t load(const std::vector<nodeid_t> &ids);
+	// 放入新建节点
+	void put(MyaiNode::ptr node);
+	bool contains(nodeid_t id) const;
+	// 持有分片锁访问已缓存的节点，不复制 shared_ptr；
+	// 未缓存时返回 false，已标记删除的节点返回 true 但不调用 fn
+	template<typename Fn>
+	bool visit(nodeid_t id, Fn &&fn) {
+		Shard &sd = shard(id);
+		std::lock_guard<std::mutex> lock(sd.mutex);
+		auto fd_rt = sd.map.find(id);
+		if (fd_rt == sd.map.end()) return false;
+		hit(sd, fd_rt->second);
+		MyaiNode &node = *fd_rt->second->node;
+		if (node.m_state != MyaiNode::NDS_DESTROY) fn(node);
+		return true;
+	}
+	// 持有分片锁遍历所有缓存节点
+	template<typename Fn>
+	void for_each(Fn &&fn) const {
+		for (auto &sd: m_shards) {
+			std::lock_guard<std::mutex> lock(sd.mutex);
+			for (auto &entry: sd.lru) {
+				fn(entry.node);
+			}
+		}
+	}
+
+	// 写回所有脏节点，返回时已落盘
+	void flush();
+
+	Statistics statistics() const;
+	size_t memory_size() const;
+	size_t memory_budget() const { return m_memory_budget; }
+
+private:
+	struct Entry {
+		MyaiNode::ptr node;
+		size_t bytes;
+	};
+	struct Shard {
+		mutable std::mutex mutex;
+		std::list<Entry> lru;// 头部为最近使用
+		std::unordered_map<nodeid_t, std::list<Entry>::iterator> map;
+		size_t bytes = 0;
+	};
+
+	Shard &shard(nodeid_t id) const { return m_shards[id % m_shards.size()]; }
+
+	// 命中时移到LRU头部并更新占用，调用方持有分片锁
+	void hit(Shard &shard, std::list<Entry>::iterator it);
+	void insert(Shard &shard, MyaiNode::ptr node);
+	void evict(Shard &shard);
+	void write_back(MyaiNode::ptr node);
+
+private:
+	MyaiDao::ptr m_dao;
+	MyaiFlusher::ptr m_flusher;
+	size_t m_memory_budget;
+	size_t m_shard_budget;
+	mutable std::vector<Shard> m_shards;
+
+	std::atomic<uint64> m_hits{0};
+	std::atomic<uint64> m_misses{0};
+	std::atomic<uint64> m_evictions{0};
+	std::atomic<uint64> m_writebacks{0};
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_MYAICACHE_H
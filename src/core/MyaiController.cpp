@@ -3,15 +3,42 @@
 //
 #include "MyaiController.h"
 
+#include <algorithm>
+
 
 MYAI_BEGIN
-void myai::MyaiController::init() {
-	m_dao			 = std::make_shared<MyaiDao>("./data");
-	m_id_alloc		 = std::make_shared<IdAllocator>(1, 100000);
+
+namespace {
+// 激活强弱的顺序：权重从高到低，相同时按id，使结果与收集顺序无关
+bool stronger(const Edge &a, const Edge &b) {
+	return a.weight > b.weight || (a.weight == b.weight && a.id < b.id);
+}
+}// namespace
+
+void myai::MyaiController::init(const String &snapshot_path) {
+	// 附加快照时段文件只读映射，修改只保留在缓存中
+	const bool read_only = !snapshot_path.empty();
+
+	m_dao			 = std::make_shared<MyaiDao>("./data", MyaiFileIO::DEF_MAX_NODE_NUM, read_only ? MyaiFileIO::IOM_MMAP_READ : MyaiFileIO::IOM_READ_WRITE);
+	m_id_alloc		 = std::make_shared<IdAllocator>(ID_BEGIN, ID_SIZE);
 	m_config		 = std::make_shared<MyaiConfig>();
-	m_service		 = std::make_shared<MyaiService>(m_dao, m_id_alloc);
-	m_driver_manager = std::make_shared<DriverManager>(m_service);
+	m_pool			 = std::make_shared<ThreadPool>();
+	m_service		 = std::make_shared<MyaiService>(m_dao, m_id_alloc, MyaiCache::DEF_MEMORY_BUDGET, m_pool);
+	m_driver_manager = std::make_shared<DriverManager>(m_service, m_driver_config);
+	// 驱动的id块每次启动按相同顺序申请，之后再加载已保存的分配状态
 	m_driver_manager->init();
+	m_id_alloc->load("./data/id_alloc.dat");
+	if (read_only) {
+		m_service->attachSnapshot(snapshot_path);
+	} else {
+		m_service->openWal("./data/myai.wal");
+	}
+	if (m_config->prefetch_max > 0) m_service->enablePrefetch(m_config->prefetch_max);
+}
+
+void MyaiController::destroy() {
+	if (m_driver_manager) m_driver_manager->stop();
+	if (m_service) m_service->checkpoint();
 }
 
 void MyaiController::run() {
@@ -21,15 +48,20 @@ void MyaiController::run() {
 		// 监视器
 	}
 
-	while (m_reasoning_size > 0) {
-		trainingCycle();
-		--m_reasoning_size;
-		// 监视器
-	}
+	// 本轮推理修改过的节点一次整理完
+	trainingCycle();
+	m_reasoning_size = 0;
 }
 
 void MyaiController::reasoningCycle() {
-	EdgeList::ptr collect = std::make_shared<EdgeList>();
+	reasoning_step();
+	// 本轮的临时对象都已析构，分配器整体回到开头
+	m_arena.reset();
+}
+
+void MyaiController::reasoning_step() {
+	// 收集表只在本轮使用，表和控制块都从本轮的分配器分配
+	EdgeList::ptr collect = std::allocate_shared<EdgeList>(std::pmr::polymorphic_allocator<EdgeList>(&m_arena), &m_arena);
 	m_driver_manager->collect(collect);
 
 	if (!m_temp_nodes.empty()) {
@@ -39,23 +71,86 @@ void MyaiController::reasoningCycle() {
 	weight_t filter_weight		  = m_driver_manager->filter();
 	const MyaiNode::ptr temp_node = m_service->createNode(filter_weight);
 
-	for (auto &[id, edge]: *collect) {
+	// 前沿和控制数组跨轮复用，只清空不释放
+	std::vector<Edge> &frontier = m_frontier;
+	std::vector<Edge> &controls = m_controls;
+	frontier.clear();
+	controls.clear();
+
+	for (auto &&[id, edge]: *collect) {
 		edge.weight = func(edge.weight) + attach_weight;
 		if (edge.weight < filter_weight) {
 			continue;
 		}
 
-		if (edge.id < DriverManager::MAX_CONTROL_NODE_ID) {
-			m_driver_manager->control(edge);
+		if (m_driver_manager->isControl(edge.id)) {
+			controls.emplace_back(edge);
 			continue;
 		}
-		m_driver_manager->activate_node(edge);
+		frontier.emplace_back(edge);
+	}
+
+	// 本轮的控制输出按激活顺序（权重从高到低）一次分发给各驱动
+	std::sort(controls.begin(), controls.end(), stronger);
+	m_driver_manager->control(controls);
+	apply_frontier_budget(frontier);
+	m_driver_manager->activate_nodes(frontier);
+	for (auto &edge: frontier) {
 		m_service->linkNode(edge.id, Edge{temp_node->id(), edge.weight});
 	}
 
 	m_temp_nodes.emplace_back(TempInfo{temp_node, attach_weight, filter_weight});
+	m_service->commit();
+}
+void MyaiController::apply_frontier_budget(std::vector<Edge> &frontier) {
+	++m_frontier_stat.cycles;
+	const size_t max_size = m_config->frontier_max;
+	const size_t budget	  = m_config->frontier_link_budget;
+
+	size_t keep = frontier.size();
+	if (max_size != 0 && frontier.size() > max_size) {
+		// 部分选择：前 max_size 个是最强的，内部无序
+		std::nth_element(frontier.begin(), frontier.begin() + max_size, frontier.end(), stronger);
+		keep = max_size;
+	}
+	if (budget != 0) {
+		std::sort(frontier.begin(), frontier.begin() + keep, stronger);
+		// 候选节点先批量加载，逐个统计链接数时不再单独读取
+		m_budget_ids.clear();
+		for (size_t i = 0; i < keep; ++i) {
+			m_budget_ids.push_back(frontier[i].id);
+		}
+		m_service->loadNodes(m_budget_ids);
+		size_t links = 0, i = 0;
+		for (; i < keep; ++i) {
+			const size_t count = m_service->linkCount(frontier[i].id);
+			// 至少保留最强的节点，即使它单独已超出预算
+			if (i > 0 && links + count > budget) break;
+			links += count;
+		}
+		keep = i;
+		m_frontier_stat.links_touched += links;
+	}
+
+	for (size_t i = keep; i < frontier.size(); ++i) {
+		m_frontier_stat.dropped_weight += frontier[i].weight;
+	}
+	m_frontier_stat.dropped += frontier.size() - keep;
+	m_frontier_stat.activated += keep;
+	frontier.resize(keep);
 }
+
 void MyaiController::trainingCycle() {
+	// 临时节点自身的缓冲按记录时的状态合并；指向它的边在推理时已计算过权重
+	std::unordered_map<nodeid_t, MyaiService::LinkRule> rules;
+	rules.reserve(m_temp_nodes.size());
+	for (auto &info: m_temp_nodes) {
+		rules[info.node->id()] = MyaiService::LinkRule{info.attach_weight, info.filter_weight};
+	}
+	m_service->consolidateLinks(rules, m_config->prune);
+	m_temp_nodes.clear();
+	// 合并后的链接落盘，日志中已合并的缓冲记录随之清空
+	m_service->checkpoint();
 }
 
 MYAI_END
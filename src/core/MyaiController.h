@@ -20,6 +20,15 @@ public:
 	using ptr	 = std::shared_ptr<MyaiConfig>;
 	MyaiConfig() = default;
 
+	// 训练合并后每个节点保留的链接数和最小权重
+	MyaiService::PruneOptions prune;
+	// 每轮推理最多激活的节点数，按权重取前N个，0为不限
+	size_t frontier_max			= 0;
+	// 每轮推理激活时最多触及的链接数，按权重从高到低装入，至少保留最强的节点，0为不限
+	size_t frontier_link_budget = 0;
+	// 每轮最多预读的下一轮前沿节点数，0为关闭
+	size_t prefetch_max			= MyaiPrefetcher::DEF_MAX_PENDING;
+
 private:
 };
 
@@ -29,25 +38,55 @@ private:
 
 class MyaiController {
 public:
-	explicit MyaiController(size_t reasoning_max = 10)
-		: m_reasoning_size(0), m_reasoning_max(reasoning_max) {
+	// 节点id范围，其中开头的 DriverManager::RESERVED_ID_SIZE 个id留给驱动
+	constexpr static nodeid_t ID_BEGIN = 1;
+	constexpr static size_t ID_SIZE	   = 0x100'0000;
+
+	explicit MyaiController(size_t reasoning_max = 10, DriverConfig driver_config = DriverConfig())
+		: m_reasoning_size(0), m_reasoning_max(reasoning_max), m_driver_config(driver_config) {
 	}
 	~MyaiController() {
 	}
 
-	void init();
-	void destroy() {}
+	/**
+	 * @brief 创建服务和驱动
+	 * @param snapshot_path 非空时以只读映射打开段文件并附加该快照，不开启日志
+	 */
+	void init(const String &snapshot_path = String());
+	void destroy();
 	void stop() {}
 
 	void run();
 
 	void reasoningCycle();
+	/**
+	 * @brief 训练：把本轮推理中所有节点的缓冲边一次合并到链接
+	 * @details 按 TempInfo 记录的 attach_weight/filter_weight 合并，
+	 *          按 MyaiConfig::prune 裁剪链接，之后做检查点
+	 */
 	void trainingCycle();
 
+	MyaiConfig::ptr config() const { return m_config; }
+	MyaiService::ptr service() const { return m_service; }
+
+	// 推理前沿的累计统计
+	struct FrontierStatistics {
+		uint64 cycles		  = 0;
+		uint64 activated	  = 0;// 激活的节点数
+		uint64 dropped		  = 0;// 因预算被丢弃的节点数
+		double dropped_weight = 0;// 被丢弃节点的权重之和
+		uint64 links_touched  = 0;// 开启链接预算时，激活节点的链接数之和
+	};
+	const FrontierStatistics &frontierStatistics() const { return m_frontier_stat; }
+
 private:
 	weight_t func(weight_t x) {
 		return x > 0 ? log2f(x + 1) : x * 0.01;
 	}
+	// 一轮推理的实际工作，返回后本轮的临时对象都已析构
+	void reasoning_step();
+	// 按 MyaiConfig 的预算裁剪本轮前沿，被丢弃的计入统计
+	void apply_frontier_budget(std::vector<Edge> &frontier);
 
 private:
 	struct TempInfo {
@@ -57,14 +96,23 @@ private:
 	};
 	size_t m_reasoning_size;
 	size_t m_reasoning_max;
+	DriverConfig m_driver_config;
 
 	MyaiDao::ptr m_dao;
 	IdAllocator::ptr m_id_alloc;
 	MyaiConfig::ptr m_config;
+	ThreadPool::ptr m_pool;
 	MyaiService::ptr m_service;
 	DriverManager::ptr m_driver_manager;
 
 	std::vector<TempInfo> m_temp_nodes;
+	FrontierStatistics m_frontier_stat;
+
+	// 每轮推理的临时分配，轮末整体重置
+	CycleArena m_arena;
+	std::vector<Edge> m_frontier;
+	std::vector<Edge> m_controls;
+	std::vector<nodeid_t> m_budget_ids;
 };
 
 MYAI_END
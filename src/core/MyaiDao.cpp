@@ -1,28 +1,32 @@
 #include "MyaiDao.h"
 
+#include <algorithm>
+#include <filesystem>
+
 MYAI_BEGIN
 
+MyaiDao::MyaiDao(String data_path, size_t segment_node_num, MyaiFileIO::OpenMode mode)
+	: m_data_path(data_path), m_segment_node_num(segment_node_num), m_mode(mode) {
+	std::filesystem::create_directories(m_data_path);
+}
+
 int MyaiDao::insert(MyaiNode::ptr node) {
-	if (!node || !node->id() == MyaiNode::NULL_ID) {
+	if (!node || node->id() == MyaiNode::NULL_ID) {
 		MYLIB_THROW("avg error: node is null or id is null");
 	}
 
-	String path = analyze_path(node->id());
-	m_file_io->open(path);
-
-	m_file_io->write(node);
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	segment(node->id())->write(node);
 	return 0;
 }
 
 int MyaiDao::updata(MyaiNode::ptr node) {
-	if (!node || !node->id() == MyaiNode::NULL_ID) {
+	if (!node || node->id() == MyaiNode::NULL_ID) {
 		MYLIB_THROW("avg error: node is null or id is null");
 	}
 
-	String path = analyze_path(node->id());
-	m_file_io->open(path);
-
-	m_file_io->write(node);
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	segment(node->id())->write(node);
 	return 0;
 }
 
@@ -31,10 +35,8 @@ int MyaiDao::deleteById(nodeid_t id) {
 		MYLIB_THROW("avg error:  id is null");
 	}
 
-	String path = analyze_path(id);
-	m_file_io->open(path);
-
-	return m_file_io->eraseId(id);
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	return segment(id)->eraseId(id);
 }
 
 MyaiNode::ptr MyaiDao::selectById(nodeid_t id) {
@@ -42,14 +44,170 @@ MyaiNode::ptr MyaiDao::selectById(nodeid_t id) {
 		MYLIB_THROW("avg error:  id is null");
 	}
 
-	String path = analyze_path(id);
-	m_file_io->open(path);
+	// 附加的快照优先，不经过段文件的锁
+	if (MyaiNode::ptr node = snapshot_node(id)) return node;
+
+	MyaiNode::ptr res = MyaiNode::create(id, MyaiNode::NULL_WEIGHT, MyaiNode::NDS_UNDEFINED);
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	return segment(id)->read(res) ? res : nullptr;
+}
+
+std::vector<MyaiNode::ptr> MyaiDao::selectMany(const std::vector<nodeid_t> &ids) {
+	std::vector<MyaiNode::ptr> res(ids.size());
+	std::vector<size_t> order;
+	order.reserve(ids.size());
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (ids[i] == MyaiNode::NULL_ID) MYLIB_THROW("avg error:  id is null");
+		// 快照中有的不再读段文件
+		res[i] = snapshot_node(ids[i]);
+		if (res[i] == nullptr) order.push_back(i);
+	}
+
+	{
+		std::vector<MyaiNode::ptr> batch;
+		std::lock_guard<std::shared_mutex> lock(m_mutex);
+		for_each_segment(order, [&](size_t i) { return ids[i]; }, [&](const MyaiFileIO::ptr &file_io, size_t begin, size_t end) {
+			batch.clear();
+			for (size_t i = begin; i < end; ++i) {
+				batch.push_back(MyaiNode::create(ids[order[i]], MyaiNode::NULL_WEIGHT, MyaiNode::NDS_UNDEFINED));
+			}
+			file_io->readMany(batch);
+			for (size_t i = begin; i < end; ++i) {
+				res[order[i]] = std::move(batch[i - begin]);
+			}
+		});
+	}
+	return res;
+}
+
+size_t MyaiDao::upsertMany(const std::vector<MyaiNode::ptr> &nodes) {
+	std::vector<MyaiNode::ptr> items;
+	items.reserve(nodes.size());
+	for (auto &node: nodes) {
+		if (!node || node->id() == MyaiNode::NULL_ID) {
+			MYLIB_THROW("avg error: node is null or id is null");
+		}
+		items.push_back(node);
+	}
+
+	size_t count = 0;
+	std::vector<MyaiNode::ptr> batch;
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	// 排序稳定，同一id的多个节点保持原顺序，写入时保留最后一个
+	for_each_segment(items, [](const MyaiNode::ptr &node) { return node->id(); }, [&](const MyaiFileIO::ptr &file_io, size_t begin, size_t end) {
+		batch.assign(items.begin() + begin, items.begin() + end);
+		count += file_io->writeMany(batch);
+	});
+	return count;
+}
+
+size_t MyaiDao::deleteMany(const std::vector<nodeid_t> &ids) {
+	std::vector<nodeid_t> items(ids);
+	for (nodeid_t id: items) {
+		if (id == MyaiNode::NULL_ID) MYLIB_THROW("avg error:  id is null");
+	}
+
+	size_t count = 0;
+	std::vector<nodeid_t> batch;
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	for_each_segment(items, [](nodeid_t id) { return id; }, [&](const MyaiFileIO::ptr &file_io, size_t begin, size_t end) {
+		batch.assign(items.begin() + begin, items.begin() + end);
+		count += file_io->eraseMany(batch);
+	});
+	return count;
+}
+
+bool MyaiDao::viewById(nodeid_t id, MyaiNodeView &view) {
+	if (id == MyaiNode::NULL_ID || !isReadOnly()) {
+		return false;
+	}
+	return mapped_segment(id)->view(id, view);
+}
+
+bool MyaiDao::prefetchById(nodeid_t id) {
+	if (id == MyaiNode::NULL_ID || !isReadOnly()) {
+		return false;
+	}
+	if (m_snapshot && m_snapshot->prefetch(id)) return true;
+	return mapped_segment(id)->prefetch(id);
+}
+
+void MyaiDao::sync() {
+	if (isReadOnly()) return;
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	for (auto &[seg, file_io]: m_segments) {
+		file_io->sync();
+	}
+}
+
+std::vector<nodeid_t> MyaiDao::ids() {
+	std::vector<uint32> segments;
+	for (auto &entry: std::filesystem::directory_iterator(m_data_path)) {
+		if (!entry.is_regular_file() || entry.path().extension() != ".seg") continue;
+		const String stem = entry.path().stem().string();
+		if (stem.empty() || stem.find_first_not_of("0123456789") != String::npos) continue;
+		segments.push_back(static_cast<uint32>(std::stoul(stem)));
+	}
+	std::sort(segments.begin(), segments.end());
 
-	MyaiNode::ptr res = std::make_shared<MyaiNode>();
-	if (m_file_io->read(res)) {
-		return res;
+	std::vector<nodeid_t> res;
+	{
+		std::lock_guard<std::shared_mutex> lock(m_mutex);
+		for (uint32 seg: segments) {
+			segment(static_cast<nodeid_t>(seg * m_segment_node_num))->for_each_index([&](nodeid_t id, MyaiFileIO::PageSpan) {
+				res.push_back(id);
+			});
+		}
 	}
-	return nullptr;
+	// 索引按槽的顺序遍历，排序后返回
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+void MyaiDao::attachSnapshot(GraphSnapshot::ptr snapshot) {
+	if (!isReadOnly()) MYLIB_THROW("avg error: snapshot can only be attached to a read only dao");
+	m_snapshot = std::move(snapshot);
+}
+
+size_t MyaiDao::upgrade(const String &data_path) {
+	size_t count = 0;
+	for (auto &entry: std::filesystem::directory_iterator(data_path)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".seg") {
+			count += MyaiFileIO::upgrade(entry.path().string()) ? 1 : 0;
+		}
+	}
+	return count;
+}
+
+MyaiFileIO::ptr MyaiDao::mapped_segment(nodeid_t id) {
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		auto fd_rt = m_segments.find(analyze_segment(id));
+		if (fd_rt != m_segments.end()) return fd_rt->second;
+	}
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	return segment(id);
+}
+
+MyaiNode::ptr MyaiDao::snapshot_node(nodeid_t id) const {
+	GraphSnapshot::Row row;
+	if (!snapshotView(id, row)) return nullptr;
+	EdgeList links;
+	links.accumulate(row.link_ids, row.link_weights, row.link_num, 1.0f);
+	return MyaiNode::create(id, row.bias, row.state, links);
+}
+
+MyaiFileIO::ptr MyaiDao::segment(nodeid_t id) {
+	const uint32 seg = analyze_segment(id);
+	auto fd_rt		 = m_segments.find(seg);
+	if (fd_rt != m_segments.end()) {
+		return fd_rt->second;
+	}
+
+	auto file_io = std::make_shared<MyaiFileIO>(m_segment_node_num);
+	file_io->open(analyze_path(seg), m_mode);
+	m_segments.emplace(seg, file_io);
+	return file_io;
 }
 
-MYAI_END
\ No newline at end of file
+MYAI_END
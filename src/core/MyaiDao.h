@@ -1,30 +1,99 @@
 #ifndef MYAI_DAO_MYAIDAO_H
 #define MYAI_DAO_MYAIDAO_H
 
+#include "GraphSnapshot.h"
 #include "MyaiFileIO.h"
 
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
 MYAI_BEGIN
 
+/**
+ * @brief 节点存取：按id区间把节点分布到若干分页段文件中
+ * @note 所有接口线程安全
+ */
 class MyaiDao {
 public:
 	using ptr = std::shared_ptr<MyaiDao>;
 
-	MyaiDao(String data_path)
-		: m_data_path(data_path),
-		  m_file_io(std::make_shared<MyaiFileIO>()) {}
+	MyaiDao(String data_path,
+			size_t segment_node_num	  = MyaiFileIO::DEF_MAX_NODE_NUM,
+			MyaiFileIO::OpenMode mode = MyaiFileIO::IOM_READ_WRITE);
 	int insert(MyaiNode::ptr node);
 	int updata(MyaiNode::ptr node);
 	int deleteById(nodeid_t id);
 	MyaiNode::ptr selectById(nodeid_t id);
 
+	/**
+	 * @brief 批量读取，结果与 ids 一一对应，不存在的为nullptr
+	 * @details 先查附加的快照，其余按段分组，每段加一次锁并合并相邻记录的读取
+	 */
+	std::vector<MyaiNode::ptr> selectMany(const std::vector<nodeid_t> &ids);
+	// 批量新建或更新，每段只刷新一次，返回写入的节点数
+	size_t upsertMany(const std::vector<MyaiNode::ptr> &nodes);
+	// 批量删除，返回删除的节点数
+	size_t deleteMany(const std::vector<nodeid_t> &ids);
+
+	// 只读映射模式下获取节点视图，其他模式返回false；段文件打开后只加共享锁
+	bool viewById(nodeid_t id, MyaiNodeView &view);
+	// 只读映射模式下预读节点记录（快照或段文件），其他模式返回false
+	bool prefetchById(nodeid_t id);
+
+	bool isReadOnly() const { return m_mode == MyaiFileIO::IOM_MMAP_READ; }
+	// 已打开的段文件全部同步到磁盘，检查点清空日志前调用
+	void sync();
+
+	// 段文件中所有节点的id（升序），不含附加的快照
+	std::vector<nodeid_t> ids();
+
+	/**
+	 * @brief 附加只读快照，快照中的节点优先于段文件
+	 * @details 启动时只需映射快照文件，不必先导入段文件；快照不可变，查找时不加锁
+	 * @note 仅只读映射模式，须在并发访问前附加，快照在 MyaiDao 析构前保持映射
+	 */
+	void attachSnapshot(GraphSnapshot::ptr snapshot);
+	// 快照中节点的只读视图，未附加快照或不存在时返回false
+	bool snapshotView(nodeid_t id, GraphSnapshot::Row &row) const {
+		return m_snapshot && m_snapshot->view(id, row);
+	}
+
+	// 将目录下所有旧版本段文件转换为当前版本，返回转换的文件数
+	static size_t upgrade(const String &data_path);
+
 private:
-	String analyze_path(nodeid_t id) {
-		return m_data_path + "/" + std::to_string(id) + ".node";
+	uint32 analyze_segment(nodeid_t id) const {
+		return static_cast<uint32>(id / m_segment_node_num);
+	}
+	String analyze_path(uint32 segment) const {
+		return m_data_path + "/" + std::to_string(segment) + ".seg";
+	}
+	// 获取id所在的段文件，首次访问时打开，调用时须持有独占锁
+	MyaiFileIO::ptr segment(nodeid_t id);
+	// 只读模式下获取段文件：已打开的只加共享锁查找，段文件打开后不再移除
+	MyaiFileIO::ptr mapped_segment(nodeid_t id);
+	// 从快照构造节点，未附加快照或不存在时返回nullptr
+	MyaiNode::ptr snapshot_node(nodeid_t id) const;
+	// 按id稳定排序后分组，对每段的 [begin, end) 调用 fn
+	template<typename T, typename Key, typename Fn>
+	void for_each_segment(std::vector<T> &items, Key &&key, Fn &&fn) {
+		std::stable_sort(items.begin(), items.end(), [&](const T &a, const T &b) { return key(a) < key(b); });
+		for (size_t begin = 0, end = 0; begin < items.size(); begin = end) {
+			const uint32 seg = analyze_segment(key(items[begin]));
+			for (end = begin + 1; end < items.size() && analyze_segment(key(items[end])) == seg; ++end) {}
+			fn(segment(key(items[begin])), begin, end);
+		}
 	}
 
 private:
 	String m_data_path;
-	MyaiFileIO::ptr m_file_io;
+	size_t m_segment_node_num;
+	MyaiFileIO::OpenMode m_mode;
+	std::unordered_map<uint32, MyaiFileIO::ptr> m_segments;
+	std::shared_mutex m_mutex;// 段文件表和读写模式下的段文件；只读查找加共享锁
+	GraphSnapshot::ptr m_snapshot;
 };
 
 MYAI_END
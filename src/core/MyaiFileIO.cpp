@@ -1,124 +1,625 @@
 #include "MyaiFileIO.h"
+#include "crc32.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
 
 #ifdef MYLIB_WINDOWS
 #include <windows.h>
 #elif MYLIB_LINUX
 #include <limits.h>
 #include <stdlib.h>
-
 #endif
 
 MYAI_BEGIN
 
-MyaiFileIO::MyaiFileIO(size_t node_max_num)
-	: m_node_max_num(node_max_num) {
+namespace {
+
+// 直接读取内存(页缓冲或映射文件)的流缓冲区，避免拷贝
+class PageStreamBuf : public std::streambuf {
+public:
+	PageStreamBuf(const byte_t *data, size_t size) {
+		auto *p = const_cast<byte_t *>(data);
+		setg(p, p, p + size);
+	}
+
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+		char *base = dir == std::ios_base::beg ? eback() : dir == std::ios_base::cur ? gptr() : egptr();
+		if (base + off < eback() || base + off > egptr()) return pos_type(off_type(-1));
+		setg(eback(), base + off, egptr());
+		return pos_type(gptr() - eback());
+	}
+	pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override {
+		return seekoff(off_type(pos), std::ios_base::beg, mode);
+	}
+};
+
+}// namespace
+
+MyaiFileIO::MyaiFileIO(size_t node_max_num, size_t page_size)
+	: m_node_max_num(node_max_num), m_page_size(page_size) {
 }
 
-void MyaiFileIO::open(std::string path) {
+void MyaiFileIO::open(std::string path, OpenMode mode) {
 	// check path
-	if (check_path_is_equal(path)) return;
+	if (is_open() && mode == m_mode && check_path_is_equal(path)) return;
+
+	if (is_open()) close();
 
 	// open init
 	m_current_path = path;
+	m_mode		   = mode;
+
+	if (m_mode == IOM_MMAP_READ) {
+		// 文件不存在时视为空段
+		// 激活访问是随机的，关闭预读
+		if (!m_map.open(m_current_path, MappedFile::MFA_RANDOM)) {
+			PageStreamBuf empty(nullptr, 0);
+			std::istream in(&empty);
+			read_head(in);
+			return;
+		}
+		PageStreamBuf buf(m_map.data(), m_map.size());
+		std::istream in(&buf);
+		if (!read_head(in)) {
+			m_map.close();
+			MYLIB_THROW("file error: file vision is not compatible, upgrade it first.");
+		}
+		if (m_map.size() < m_head.data_offset) {
+			m_map.close();
+			MYLIB_THROW("file error: index is corrupted.");
+		}
+		// 只读映射，只会通过 m_slots 读取
+		m_slots = reinterpret_cast<IndexSlot *>(const_cast<byte_t *>(m_map.data()) + m_head.index_offset);
+		return;
+	}
 
-	if (m_fs.is_open()) close();
 	m_fs.open(m_current_path, std::ios::in | std::ios::out | std::ios::binary);
+	if (!m_fs.is_open()) {
+		// 文件不存在时先创建
+		std::ofstream(m_current_path, std::ios::out | std::ios::binary).close();
+		m_fs.open(m_current_path, std::ios::in | std::ios::out | std::ios::binary);
+	}
 	if (!m_fs.is_open()) MYLIB_THROW("file error: file open failed.");
 
 	// read init
-	read_head();
-	read_index(m_head);
+	if (!read_head(m_fs)) {
+		// 版本不符时不回写文件头
+		m_fs.close();
+		MYLIB_THROW("file error: file vision is not compatible, upgrade it first.");
+	}
+
+	// 新文件先扩展到数据区起点，索引区补零即全部为空槽
+	m_fs.seekp(0, std::ios::end);
+	if (static_cast<size_t>(m_fs.tellp()) < m_head.data_offset) {
+		m_fs.seekp(static_cast<std::streamoff>(m_head.data_offset - 1));
+		m_fs.put(0);
+		m_fs.flush();
+	}
+	if (!m_map.open_writable(m_current_path, m_head.data_offset, MappedFile::MFA_RANDOM)) {
+		m_fs.close();
+		MYLIB_THROW("file error: index map failed.");
+	}
+	m_slots = reinterpret_cast<IndexSlot *>(m_map.mutable_data() + m_head.index_offset);
+	write_head();
 }
 
 void MyaiFileIO::close() {
+	if (m_mode == IOM_MMAP_READ) {
+		m_map.close();
+		m_slots = nullptr;
+		m_mode	= IOM_READ_WRITE;
+		return;
+	}
 	if (!m_fs.is_open()) {
 		return;
 	}
 
-	write_index(m_head);
 	write_head();
+	m_map.close();
+	m_slots = nullptr;
+	m_free_spans.clear();
+	m_free_sizes.clear();
+	m_free_loaded = false;
 
 	m_fs.close();
 	m_fs.clear();
 }
 
+void MyaiFileIO::sync() {
+	if (m_mode == IOM_MMAP_READ || !m_fs.is_open()) return;
+	m_fs.flush();
+	// 先落盘数据页，再落盘指向它们的索引
+	if (!m_fs || !MappedFile::sync_file(m_current_path) || !m_map.sync()) MYLIB_THROW("file error: file sync failed.");
+}
+
 bool MyaiFileIO::read(MyaiNode::ptr node) {
-	if (!m_fs.is_open()) MYLIB_THROW("file error:file is not open");
+	if (!is_open()) MYLIB_THROW("file error:file is not open");
 	if (!node) MYLIB_THROW("avg error:avg is nullptr");
 
-	auto g_rt = get_node_pos(node->id());
+	auto span = get_node_span(node->id());
 
-	if (g_rt == MyaiNode::NULL_ID) return false;
-	read_node(node, g_rt);
+	if (span.page == NULL_PAGE) return false;
+	if (!read_node(node, span)) MYLIB_THROW("file error: node record is corrupted");
 	return true;
 }
 
 bool MyaiFileIO::write(const MyaiNode::ptr &node) {
+	if (m_mode == IOM_MMAP_READ) MYLIB_THROW("file error:file is read only");
 	if (!m_fs.is_open()) MYLIB_THROW("file error:file is not open");
 	if (!node) MYLIB_THROW("avg error:avg is nullptr");
 
-	const auto g_rt = get_node_pos(node->id());
+	std::ostringstream oss(std::ios::binary);
+	node->serialize(oss);
+	const String data	 = oss.str();
+	const pageid_t count = static_cast<pageid_t>((data.size() + m_head.page_size - 1) / m_head.page_size);
+	load_free_spans();
+
+	const size_t slot = probe_slot(node->id());
+	if (slot == m_head.max_node_num) MYLIB_THROW("avg error: index is full");
 
-	if (g_rt == MyaiNode::NULL_ID) {
-		MYLIB_ASSERT(m_index.size() < m_head.max_node_num, "avg error: index is full");
-		m_fs.seekp(m_head.index_offset + m_head.max_node_num * m_head.head_size);
-		m_index.emplace(node->id(), m_fs.tellp());
+	IndexSlot entry	  = m_slots[slot];
+	const bool is_new = entry.span.page == NULL_PAGE;
+	PageSpan released;// 新记录写入后再释放的页
+	if (is_new) {
+		entry.id   = node->id();
+		entry.span = alloc_pages(count);
+	} else if (entry.span.count < count) {
+		// 原位置放不下，重新分配
+		released   = entry.span;
+		entry.span = alloc_pages(count);
+	} else if (entry.span.count > count) {
+		// 归还多余的尾页
+		released		 = PageSpan{entry.span.page + count, entry.span.count - count};
+		entry.span.count = count;
 	}
 
-	write_node(node, g_rt);
+	write_node(data, entry.span);
+	// 数据页先写入文件再更新索引，进程中途退出时索引不会指向未写入的页
+	m_fs.flush();
+	m_slots[slot] = entry;
+	if (is_new) ++m_head.index_num;
+	if (released.count > 0) free_pages(released);
+	write_head();
 	return true;
 }
 
-std::streampos MyaiFileIO::get_node_pos(nodeid_t id) const noexcept {
-	auto fd_rt = m_index.find(id);
-	if (fd_rt == m_index.end()) {
-		return MyaiNode::NULL_ID;
+bool MyaiFileIO::view(nodeid_t id, MyaiNodeView &view) const {
+	if (!is_mapped()) return false;
+
+	const auto span = get_node_span(id);
+	if (span.page == NULL_PAGE) return false;
+
+	const size_t pos = static_cast<size_t>(page_pos(span.page));
+	if (pos >= m_map.size()) return false;
+	return MyaiNode::make_view(m_map.data() + pos, std::min<size_t>(span.count * m_head.page_size, m_map.size() - pos), view);
+}
+
+bool MyaiFileIO::prefetch(nodeid_t id) const {
+	if (!is_mapped()) return false;
+
+	const auto span = get_node_span(id);
+	if (span.page == NULL_PAGE) return false;
+	m_map.will_need(static_cast<size_t>(page_pos(span.page)), span.count * m_head.page_size);
+	return true;
+}
+
+int MyaiFileIO::eraseId(nodeid_t id) {
+	if (m_mode == IOM_MMAP_READ) MYLIB_THROW("file error:file is read only");
+	const size_t slot = probe_slot(id);
+	if (slot == m_head.max_node_num || m_slots[slot].span.page == NULL_PAGE) {
+		return 0;
+	}
+	load_free_spans();
+	const PageSpan span = m_slots[slot].span;
+	erase_slot(slot);
+	--m_head.index_num;
+	free_pages(span);
+	write_head();
+	return 1;
+}
+
+size_t MyaiFileIO::readMany(std::vector<MyaiNode::ptr> &nodes) {
+	if (!is_open()) MYLIB_THROW("file error:file is not open");
+
+	std::vector<std::pair<PageSpan, size_t>> spans;
+	spans.reserve(nodes.size());
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		if (!nodes[i]) MYLIB_THROW("avg error:avg is nullptr");
+		const auto span = get_node_span(nodes[i]->id());
+		if (span.page == NULL_PAGE) {
+			nodes[i] = nullptr;
+			continue;
+		}
+		spans.emplace_back(span, i);
 	}
-	return fd_rt->second;
+	std::sort(spans.begin(), spans.end(), [](const auto &a, const auto &b) { return a.first.page < b.first.page; });
+
+	for (size_t begin = 0, end = 0; begin < spans.size(); begin = end) {
+		// 相邻或间隔很小的记录合并为一次读取，映射模式下整个文件即一段
+		const pageid_t first = spans[begin].first.page;
+		pageid_t last		 = first + spans[begin].first.count;
+		for (end = begin + 1; end < spans.size(); ++end) {
+			const PageSpan &span = spans[end].first;
+			if (!is_mapped() && (span.page > last + MAX_COALESCE_GAP ||
+								 (span.page + span.count - first) * m_head.page_size > MAX_COALESCE_SIZE)) {
+				break;
+			}
+			last = std::max<pageid_t>(last, span.page + span.count);
+		}
+
+		const byte_t *data = nullptr;
+		size_t size		   = 0;
+		if (is_mapped()) {
+			const size_t pos = static_cast<size_t>(page_pos(first));
+			data			 = m_map.data() + std::min(pos, m_map.size());
+			size			 = m_map.size() - std::min(pos, m_map.size());
+		} else {
+			m_page_buf.resize((last - first) * m_head.page_size);
+			m_fs.seekg(page_pos(first));
+			m_fs.read(m_page_buf.data(), static_cast<std::streamsize>(m_page_buf.size()));
+			size = static_cast<size_t>(m_fs.gcount());
+			data = m_page_buf.data();
+			m_fs.clear();
+		}
+
+		for (size_t i = begin; i < end; ++i) {
+			const PageSpan &span = spans[i].first;
+			const size_t offset	 = (span.page - first) * m_head.page_size;
+			const bool ok		 = offset < size && parse_node(nodes[spans[i].second], data + offset,
+																std::min<size_t>(span.count * m_head.page_size, size - offset));
+			if (!ok) MYLIB_THROW("file error: node record is corrupted");
+		}
+	}
+	return spans.size();
 }
 
-void MyaiFileIO::read_head() noexcept {
-	m_fs.seekg(0);
-	char magic_head[8];
-	m_fs.read(reinterpret_cast<byte_t *>(&magic_head), sizeof(magic_head));
-	if (std::string(magic_head) == MyaiFileIO::MAGIC_HEAD) {
-		m_fs.read(reinterpret_cast<byte_t *>(&m_head), m_head.head_size);
+size_t MyaiFileIO::writeMany(const std::vector<MyaiNode::ptr> &nodes) {
+	if (m_mode == IOM_MMAP_READ) MYLIB_THROW("file error:file is read only");
+	if (!m_fs.is_open()) MYLIB_THROW("file error:file is not open");
+
+	// 按id排序，同一id只保留最后一个
+	std::vector<const MyaiNode::ptr *> order;
+	order.reserve(nodes.size());
+	for (auto &node: nodes) {
+		if (!node) MYLIB_THROW("avg error:avg is nullptr");
+		order.push_back(&node);
+	}
+	std::stable_sort(order.begin(), order.end(), [](const MyaiNode::ptr *a, const MyaiNode::ptr *b) { return (*a)->id() < (*b)->id(); });
+	for (size_t i = 0; i + 1 < order.size(); ++i) {
+		if ((*order[i])->id() == (*order[i + 1])->id()) order[i] = nullptr;
+	}
+	order.erase(std::remove(order.begin(), order.end(), nullptr), order.end());
+
+	struct Record {
+		nodeid_t id;
+		PageSpan span;
+		PageSpan released;
+		String data;
+	};
+	std::vector<Record> records(order.size());
+	size_t new_num = 0;
+	for (size_t i = 0; i < order.size(); ++i) {
+		Record &rec = records[i];
+		rec.id		= (*order[i])->id();
+		std::ostringstream oss(std::ios::binary);
+		(*order[i])->serialize(oss);
+		rec.data = oss.str();
+		rec.span = get_node_span(rec.id);
+		if (rec.span.page == NULL_PAGE) ++new_num;
+	}
+	// 分配页之前检查，避免写到一半时索引已满
+	if (m_head.index_num + new_num > m_head.max_node_num) MYLIB_THROW("avg error: index is full");
+	load_free_spans();
+
+	for (auto &rec: records) {
+		const pageid_t count = static_cast<pageid_t>((rec.data.size() + m_head.page_size - 1) / m_head.page_size);
+		if (rec.span.page == NULL_PAGE) {
+			rec.span = alloc_pages(count);
+		} else if (rec.span.count < count) {
+			rec.released = rec.span;
+			rec.span	 = alloc_pages(count);
+		} else if (rec.span.count > count) {
+			rec.released   = PageSpan{rec.span.page + count, rec.span.count - count};
+			rec.span.count = count;
+		}
+	}
+
+	// 按页号排序，页号连续的记录拼接后一次写入
+	std::vector<const Record *> writes;
+	writes.reserve(records.size());
+	for (auto &rec: records) writes.push_back(&rec);
+	std::sort(writes.begin(), writes.end(), [](const Record *a, const Record *b) { return a->span.page < b->span.page; });
+	for (size_t begin = 0, end = 0; begin < writes.size(); begin = end) {
+		m_page_buf.clear();
+		pageid_t next = writes[begin]->span.page;
+		for (end = begin; end < writes.size() && writes[end]->span.page == next; ++end) {
+			const size_t size = writes[end]->span.count * m_head.page_size;
+			if (end > begin && m_page_buf.size() + size > MAX_COALESCE_SIZE) break;
+			m_page_buf.insert(m_page_buf.end(), writes[end]->data.begin(), writes[end]->data.end());
+			m_page_buf.resize(m_page_buf.size() + size - writes[end]->data.size(), 0);
+			next += writes[end]->span.count;
+		}
+		m_fs.seekp(page_pos(writes[begin]->span.page));
+		m_fs.write(m_page_buf.data(), static_cast<std::streamsize>(m_page_buf.size()));
+	}
+	// 数据页全部写入文件后再更新索引
+	m_fs.flush();
+
+	for (auto &rec: records) {
+		const size_t slot = probe_slot(rec.id);
+		if (m_slots[slot].span.page == NULL_PAGE) ++m_head.index_num;
+		m_slots[slot] = IndexSlot{rec.id, rec.span};
+	}
+	for (auto &rec: records) {
+		if (rec.released.count > 0) free_pages(rec.released);
+	}
+	write_head();
+	return records.size();
+}
+
+size_t MyaiFileIO::eraseMany(const std::vector<nodeid_t> &ids) {
+	if (m_mode == IOM_MMAP_READ) MYLIB_THROW("file error:file is read only");
+	load_free_spans();
+	size_t count = 0;
+	for (nodeid_t id: ids) {
+		const size_t slot = probe_slot(id);
+		if (slot == m_head.max_node_num || m_slots[slot].span.page == NULL_PAGE) continue;
+		const PageSpan span = m_slots[slot].span;
+		erase_slot(slot);
+		--m_head.index_num;
+		free_pages(span);
+		++count;
+	}
+	if (count > 0) write_head();
+	return count;
+}
+
+MyaiFileIO::PageSpan MyaiFileIO::get_node_span(nodeid_t id) const noexcept {
+	const size_t slot = probe_slot(id);
+	if (slot == m_head.max_node_num) {
+		return PageSpan{};
+	}
+	// 空槽的 page 为 NULL_PAGE
+	return m_slots[slot].span;
+}
+
+size_t MyaiFileIO::probe_slot(nodeid_t id) const noexcept {
+	const size_t cap = m_head.max_node_num;
+	if (m_slots == nullptr || cap == 0) return cap;
+	size_t slot = id % cap;
+	for (size_t n = 0; n < cap; ++n) {
+		const IndexSlot &entry = m_slots[slot];
+		if (entry.span.page == NULL_PAGE || entry.id == id) return slot;
+		if (++slot == cap) slot = 0;
+	}
+	return cap;
+}
+
+void MyaiFileIO::erase_slot(size_t slot) noexcept {
+	const size_t cap = m_head.max_node_num;
+	// 表满时没有空槽，最多检查其余 cap-1 个槽
+	for (size_t next = slot, n = 1; n < cap; ++n) {
+		if (++next == cap) next = 0;
+		if (m_slots[next].span.page == NULL_PAGE) break;
+		// next 的起始槽不在 (slot, next] 内时，可以前移到 slot
+		const size_t home = m_slots[next].id % cap;
+		const bool keep	  = slot <= next ? (home > slot && home <= next) : (home > slot || home <= next);
+		if (!keep) {
+			m_slots[slot] = m_slots[next];
+			slot		  = next;
+		}
+	}
+	m_slots[slot] = IndexSlot{};
+}
+
+MyaiFileIO::PageSpan MyaiFileIO::alloc_pages(pageid_t count) {
+	// 最佳适配：取放得下的最小空闲段，剩余的页放回
+	auto fit = m_free_sizes.lower_bound({count, NULL_PAGE});
+	if (fit != m_free_sizes.end()) {
+		const PageSpan free{fit->second, fit->first};
+		m_free_sizes.erase(fit);
+		m_free_spans.erase(free.page);
+		// 剩余部分两侧都是已用页，不需要合并
+		if (free.count > count) insert_free(PageSpan{free.page + count, free.count - count});
+		return PageSpan{free.page, count};
+	}
+
+	// 文件末尾的空闲段不够时向后扩展
+	PageSpan span{m_head.page_num + 1, count};
+	if (!m_free_spans.empty()) {
+		auto tail = std::prev(m_free_spans.end());
+		if (tail->first + tail->second == m_head.page_num + 1) {
+			span.page = tail->first;
+			m_free_sizes.erase({tail->second, tail->first});
+			m_free_spans.erase(tail);
+		}
+	}
+	m_head.page_num = span.page + count - 1;
+	return span;
+}
+
+void MyaiFileIO::free_pages(PageSpan span) {
+	if (span.count == 0) return;
+	// 与前后相邻的空闲段合并
+	auto next = m_free_spans.lower_bound(span.page);
+	if (next != m_free_spans.end() && span.page + span.count == next->first) {
+		span.count += next->second;
+		m_free_sizes.erase({next->second, next->first});
+		next = m_free_spans.erase(next);
+	}
+	if (next != m_free_spans.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == span.page) {
+			span = PageSpan{prev->first, prev->second + span.count};
+			m_free_sizes.erase({prev->second, prev->first});
+			m_free_spans.erase(prev);
+		}
+	}
+	insert_free(span);
+}
+
+void MyaiFileIO::insert_free(PageSpan span) {
+	m_free_spans.emplace(span.page, span.count);
+	m_free_sizes.emplace(span.count, span.page);
+}
+
+void MyaiFileIO::load_free_spans() {
+	if (m_free_loaded) return;
+	std::vector<PageSpan> used;
+	used.reserve(m_head.index_num);
+	for_each_index([&](nodeid_t, PageSpan span) { used.push_back(span); });
+	std::sort(used.begin(), used.end(), [](const PageSpan &a, const PageSpan &b) { return a.page < b.page; });
+
+	// 索引未引用的页即空闲页，相邻的已连成一段
+	pageid_t next = 1;
+	for (auto &span: used) {
+		if (span.page > next) insert_free(PageSpan{next, span.page - next});
+		next = std::max<pageid_t>(next, span.page + span.count);
+	}
+	if (m_head.page_num + 1 > next) insert_free(PageSpan{next, m_head.page_num + 1 - next});
+	m_head.free_page = NULL_PAGE;
+	m_free_loaded	 = true;
+}
+
+bool MyaiFileIO::read_head(std::istream &in) {
+	in.seekg(0);
+	char magic_head[sizeof(MAGIC_HEAD)]{};
+	in.read(reinterpret_cast<byte_t *>(&magic_head), sizeof(magic_head));
+	if (in && std::string(magic_head) == MyaiFileIO::MAGIC_HEAD) {
+		in.read(reinterpret_cast<byte_t *>(&m_head), sizeof(m_head));
+		if (m_head.file_vision != FILE_VISION || m_head.index_size != sizeof(IndexSlot)) return false;
 	} else {
-		m_head = FileHead();
+		m_head				= FileHead();
+		m_head.max_node_num = m_node_max_num;
+		m_head.page_size	= m_page_size;
 	}
+	in.clear();
+	m_head.data_offset = m_head.index_offset + m_head.max_node_num * m_head.index_size;
+	return true;
 }
 
 void MyaiFileIO::write_head() noexcept {
-	m_fs.seekg(0);
-	m_fs.write(reinterpret_cast<const byte_t *>(&MAGIC_HEAD), sizeof(MAGIC_HEAD));
-	m_fs.write(reinterpret_cast<const byte_t *>(&m_head), m_head.head_size);
+	byte_t *data = m_map.mutable_data();
+	if (data == nullptr) return;
+	std::memcpy(data, MAGIC_HEAD, sizeof(MAGIC_HEAD));
+	std::memcpy(data + sizeof(MAGIC_HEAD), &m_head, sizeof(m_head));
 }
 
-void MyaiFileIO::read_index(const FileHead &head) noexcept {
-	m_fs.seekg(head.index_offset);
-	FileIndex::value_type index;
-	for (int i = 0; i < head.index_num; ++i) {
-		m_fs.read(reinterpret_cast<byte_t *>(&m_index), head.index_size);
-		m_index.emplace(index);
+bool MyaiFileIO::read_node(MyaiNode::ptr node, PageSpan span) {
+	if (is_mapped()) {
+		// 映射模式直接在映射内存上反序列化
+		const size_t pos = static_cast<size_t>(page_pos(span.page));
+		if (pos >= m_map.size()) return false;
+		return parse_node(node, m_map.data() + pos, std::min<size_t>(span.count * m_head.page_size, m_map.size() - pos));
 	}
+
+	// 一次定位读取节点的全部页
+	m_page_buf.resize(span.count * m_head.page_size);
+	m_fs.seekg(page_pos(span.page));
+	m_fs.read(m_page_buf.data(), static_cast<std::streamsize>(m_page_buf.size()));
+	m_fs.clear();
+	return parse_node(node, m_page_buf.data(), m_page_buf.size());
 }
 
-void MyaiFileIO::write_index(FileHead &head) noexcept {
-	head.index_num = m_index.size();
-	m_fs.seekg(head.index_offset);
-	for (auto &i: m_index) {
-		m_fs.write(reinterpret_cast<const byte_t *>(&i), head.index_size);
-	}
+bool MyaiFileIO::parse_node(const MyaiNode::ptr &node, const byte_t *data, size_t size) {
+	PageStreamBuf buf(data, size);
+	std::istream in(&buf);
+	node->deserialize(in);
+	return !in.fail();
 }
 
-void MyaiFileIO::read_node(MyaiNode::ptr node, std::streampos pos) noexcept {
-	m_fs.seekg(pos);
-	node->deserialize(m_fs);
+void MyaiFileIO::write_node(const String &data, PageSpan span) noexcept {
+	m_fs.seekp(page_pos(span.page));
+	m_fs.write(data.data(), static_cast<std::streamsize>(data.size()));
+	// 补齐最后一页，保证文件长度覆盖所有已分配页
+	const size_t padding = span.count * m_head.page_size - data.size();
+	if (padding > 0) {
+		m_page_buf.assign(padding, 0);
+		m_fs.write(m_page_buf.data(), static_cast<std::streamsize>(padding));
+	}
 }
 
-void MyaiFileIO::write_node(MyaiNode::ptr node, std::streampos pos) noexcept {
-	m_fs.seekp(pos);
-	node->serialize(m_fs);
+bool MyaiFileIO::upgrade(const String &path) {
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in.is_open()) MYLIB_THROW("file error: file open failed.");
+
+	char magic_head[sizeof(MAGIC_HEAD)]{};
+	FileHead head;
+	in.read(reinterpret_cast<byte_t *>(&magic_head), sizeof(magic_head));
+	in.read(reinterpret_cast<byte_t *>(&head), sizeof(head));
+	if (!in || std::string(magic_head) != MAGIC_HEAD) MYLIB_THROW("file error: not a myai segment file.");
+	if (head.file_vision == FILE_VISION) return false;
+	// IOFV_PAGED 的记录由 operator<< 连续写出，字段间无分隔，无法还原
+	if (head.file_vision == IOFV_PAGED) MYLIB_THROW("file error: text records of file vision 1 can not be upgraded.");
+	if (head.file_vision != IOFV_RAW_RECORD && head.file_vision != IOFV_CHECKED_RECORD && head.file_vision != IOFV_HASHED_INDEX) {
+		MYLIB_THROW("file error: file vision can not be upgraded.");
+	}
+	const bool checked = head.file_vision != IOFV_RAW_RECORD;
+
+	// IOFV_RAW_RECORD 的记录：id | bias | state | link_num | Edge[link_num]
+	struct RecordHeadRaw {
+		nodeid_t id;
+		weight_t bias;
+		MyaiNode::enum_size state;
+		uint32 link_num;
+	};
+	// IOFV_CHECKED_RECORD、IOFV_HASHED_INDEX 的记录：length | crc | RecordHeadRaw | Edge[link_num]，crc 覆盖 length 之后的全部字节
+	struct RecordHeadChecked {
+		uint32 length;
+		uint32 crc;
+		RecordHeadRaw raw;
+	};
+
+	// IOFV_HASHED_INDEX 的索引区是 max_node_num 个槽，之前的版本是按id排序的 index_num 项
+	std::vector<std::pair<nodeid_t, PageSpan>> index(head.file_vision == IOFV_HASHED_INDEX ? head.max_node_num : head.index_num);
+	in.seekg(static_cast<std::streamoff>(head.index_offset));
+	in.read(reinterpret_cast<byte_t *>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(index[0])));
+	if (!in) MYLIB_THROW("file error: index is corrupted.");
+	if (head.file_vision == IOFV_HASHED_INDEX) {
+		index.erase(std::remove_if(index.begin(), index.end(), [](const auto &item) { return item.second.page == NULL_PAGE; }), index.end());
+	}
+
+	const String temp_path = path + ".upgrade";
+	{
+		MyaiFileIO out(head.max_node_num, head.page_size);
+		out.open(temp_path);
+		const size_t data_offset = head.file_vision == IOFV_HASHED_INDEX ? head.data_offset : head.index_offset + head.max_node_num * head.index_size;
+		std::vector<Edge> edges;
+		for (auto &[id, span]: index) {
+			in.seekg(static_cast<std::streamoff>(data_offset + (span.page - 1) * head.page_size));
+
+			RecordHeadChecked rec{};
+			const size_t head_size = checked ? sizeof(rec) : sizeof(rec.raw);
+			in.read(checked ? reinterpret_cast<byte_t *>(&rec) : reinterpret_cast<byte_t *>(&rec.raw), static_cast<std::streamsize>(head_size));
+			// 边数不能超出所占的页
+			const size_t span_size = static_cast<size_t>(span.count) * head.page_size;
+			if (!in || rec.raw.id != id || span_size < head_size || rec.raw.link_num > (span_size - head_size) / sizeof(Edge)) {
+				MYLIB_THROW("file error: node record is corrupted");
+			}
+			edges.resize(rec.raw.link_num);
+			in.read(reinterpret_cast<byte_t *>(edges.data()), static_cast<std::streamsize>(edges.size() * sizeof(Edge)));
+			if (!in) MYLIB_THROW("file error: node record is corrupted");
+			if (checked) {
+				const uint32 crc = crc32::update(crc32::update(0, &rec.raw, sizeof(rec.raw)), edges.data(), edges.size() * sizeof(Edge));
+				if (rec.length != head_size + edges.size() * sizeof(Edge) || crc != rec.crc) MYLIB_THROW("file error: node record is corrupted");
+			}
+			const RecordHeadRaw &raw = rec.raw;
+
+			EdgeList links;
+			links.accumulate(edges.data(), edges.size(), 1.0f);
+			// 旧记录没有日志序号，按0处理
+			out.write(MyaiNode::create(raw.id, raw.bias, static_cast<MyaiNode::State>(raw.state), links));
+		}
+		out.close();
+	}
+	in.close();
+
+	std::filesystem::rename(temp_path, path);
+	return true;
 }
 
 bool MyaiFileIO::check_path_is_equal(String other) const noexcept {
@@ -129,16 +630,11 @@ bool MyaiFileIO::check_path_is_equal(String other) const noexcept {
 #elif MYLIB_LINUX
 	char fullpath[2][PATH_MAX];
 
-	realpath(other.c_str(), fullpath[0]);
-	realpath(m_current_path.c_str(), fullpath[1]);
-
-	if (strcmp(fullpath1, fullpath2) == 0) {
-		std::cout << "The paths are equivalent." << std::endl;
-	} else {
-		std::cout << "The paths are not equivalent." << std::endl;
+	if (!realpath(other.c_str(), fullpath[0]) || !realpath(m_current_path.c_str(), fullpath[1])) {
+		return other == m_current_path;
 	}
 #endif// DEBUG
 	return strcmp(fullpath[0], fullpath[1]) == 0;
 }
 
-MYAI_END
\ No newline at end of file
+MYAI_END
@@ -1,73 +1,176 @@
 #ifndef MYAI_DAO_MYAIFILEIO_H
 #define MYAI_DAO_MYAIFILEIO_H
 
+#include "MappedFile.h"
 #include "MyaiNode.h"
 #include "define.h"
 
 #include <fstream>
 #include <map>
+#include <set>
 
 
 MYAI_BEGIN
 
-
+/**
+ * @brief 分页节点段文件
+ * @details 文件布局：魔数 | 文件头 | 索引区(max_node_num项) | 数据页...
+ *          每个节点占用连续的若干固定大小页；空闲页不落盘，首次修改前由索引未引用的页重建，
+ *          相邻的空闲页合并成段，分配时按最佳适配复用多页记录
+ *          索引区是开放寻址的哈希表（id % max_node_num 定位，线性探测），
+ *          文件头和索引区整体映射到内存，原位查找和修改，打开时不读取索引
+ */
 class MyaiFileIO {
 public:
+	using pageid_t = uint32;
+
+	// 节点所在的连续页
+	struct PageSpan {
+		pageid_t page  = 0;
+		pageid_t count = 0;
+	};
+
+	// 索引槽，span.page 为 NULL_PAGE 时为空槽
+	struct IndexSlot {
+		nodeid_t id = MyaiNode::NULL_ID;
+		PageSpan span;
+	};
+
 	using ptr								 = std::shared_ptr<MyaiFileIO>;
-	using FileIndex							 = std::map<nodeid_t, std::streampos>;
 	constexpr static char MAGIC_HEAD[]		 = "MYAIDBF";
-	constexpr static uint32 FILE_VISION		 = 1;
+	constexpr static uint32 FILE_VISION		 = 5;// IOFV_APPLIED_LSN
 	constexpr static size_t DEF_MAX_NODE_NUM = 0x10000;
+	constexpr static size_t DEF_PAGE_SIZE	 = 0x1000;
+	constexpr static pageid_t NULL_PAGE		 = 0;
+
+	// 批量读写时合并为一次 IO 的上限，读取时可跨过的空隙页数
+	constexpr static size_t MAX_COALESCE_SIZE  = 1ULL << 20;
+	constexpr static pageid_t MAX_COALESCE_GAP = 2;
 
+	// 写入文件的版本号，已发布的值不能改动，新版本只能追加在最后
 	enum FileVision {
-		IOFV_UNCOMPULANT,
+		IOFV_UNCOMPULANT	= 0,
+		IOFV_PAGED			= 1,// 分页段文件，记录为 operator<< 写出的文本
+		IOFV_RAW_RECORD		= 2,// 分页段文件，记录为二进制的记录头和边数组，无长度和校验
+		IOFV_CHECKED_RECORD = 3,// 分页段文件，记录带长度前缀和crc
+		IOFV_HASHED_INDEX	= 4,// 索引区为原位查找的哈希表
+		IOFV_APPLIED_LSN	= 5,// 记录头带已合并的日志序号
+	};
+	static_assert(FILE_VISION == IOFV_APPLIED_LSN, "FILE_VISION must be the newest file vision");
+
+	enum OpenMode {
+		IOM_READ_WRITE,// 读写：通过文件流访问数据页，索引区映射到内存
+		IOM_MMAP_READ, // 只读：整个文件映射到内存
 	};
 
 	struct FileHead {
-		uint32 file_vision	= IOFV_UNCOMPULANT;
+		uint32 file_vision	= FILE_VISION;
 		size_t head_size	= sizeof(FileHead);
 		size_t max_node_num = DEF_MAX_NODE_NUM;
-		size_t index_offset = sizeof(FileHead);
-		size_t index_size	= sizeof(FileIndex::value_type);
+		size_t index_offset = sizeof(MAGIC_HEAD) + sizeof(FileHead);
+		size_t index_size	= sizeof(IndexSlot);
 		size_t index_num	= 0;
+		size_t page_size	= DEF_PAGE_SIZE;
+		size_t data_offset	= 0;		 // 第1页的文件偏移
+		pageid_t page_num	= 0;		 // 已分配的页数
+		pageid_t free_page	= NULL_PAGE;// 不再使用（旧文件的空闲页链表头），重建空闲段后清空
 	};
 
-	MyaiFileIO(size_t node_max_num = DEF_MAX_NODE_NUM);
+	MyaiFileIO(size_t node_max_num = DEF_MAX_NODE_NUM, size_t page_size = DEF_PAGE_SIZE);
+	~MyaiFileIO() { close(); }
 
-	inline const FileIndex &index() const { return m_index; }
 	inline const FileHead &head() const { return m_head; }
-	inline bool is_open() { return m_fs.is_open(); }
+	inline bool is_open() { return m_fs.is_open() || m_mode == IOM_MMAP_READ; }
+	inline bool is_mapped() const { return m_mode == IOM_MMAP_READ && m_map.is_open(); }
+	inline size_t index_num() const { return m_head.index_num; }
+	// 遍历索引中的所有节点，顺序为槽的顺序
+	template<typename Fn>
+	void for_each_index(Fn &&fn) const {
+		if (m_slots == nullptr) return;
+		for (size_t i = 0; i < m_head.max_node_num; ++i) {
+			if (m_slots[i].span.page != NULL_PAGE) fn(m_slots[i].id, m_slots[i].span);
+		}
+	}
 
-	void open(std::string path);
+	void open(std::string path, OpenMode mode = IOM_READ_WRITE);
 	void close();
+	/**
+	 * @brief 把已写出的数据页和映射的文件头、索引区同步到磁盘
+	 * @details 数据页 fdatasync，索引区 msync(MS_SYNC)；只读或未打开时不做任何事
+	 */
+	void sync();
 
 	bool read(MyaiNode::ptr node);
 	bool write(const MyaiNode::ptr &node);
+	// 只读映射模式下返回节点记录的零拷贝视图
+	bool view(nodeid_t id, MyaiNodeView &view) const;
+	// 只读映射模式下预读节点记录所在的页，不等待读完
+	bool prefetch(nodeid_t id) const;
+
+	int eraseId(nodeid_t id);
+
+	/**
+	 * @brief 批量读取，nodes 中为待读的id，不存在的置为nullptr
+	 * @details 按页号排序，相邻或间隔很小的记录合并为一次读取
+	 * @return 读到的节点数
+	 */
+	size_t readMany(std::vector<MyaiNode::ptr> &nodes);
+	/**
+	 * @brief 批量写入，同一id只保留最后一个
+	 * @details 先分配所有记录的页并按页号合并写入，刷新一次后再更新索引、释放旧页
+	 * @return 写入的节点数
+	 */
+	size_t writeMany(const std::vector<MyaiNode::ptr> &nodes);
+	// 批量删除，文件头只写一次，返回删除的节点数
+	size_t eraseMany(const std::vector<nodeid_t> &ids);
+
+	// 将旧版本段文件一次性转换为当前版本，已是当前版本时返回false
+	static bool upgrade(const String &path);
 
-	int eraseId(nodeid_t id) {
-		return m_index.erase(id);
+private:
+	PageSpan get_node_span(nodeid_t id) const noexcept;
+	std::streampos page_pos(pageid_t page) const noexcept {
+		return static_cast<std::streamoff>(m_head.data_offset + (page - 1) * m_head.page_size);
 	}
 
-private:
-	std::streampos get_node_pos(nodeid_t id) const noexcept;
+	PageSpan alloc_pages(pageid_t count);
+	// 归还页并与相邻的空闲段合并
+	void free_pages(PageSpan span);
+	void insert_free(PageSpan span);
+	// 由索引重建空闲段，修改文件前调用，只重建一次
+	void load_free_spans();
 
-	void read_head() noexcept;
+	bool read_head(std::istream &in);
+	// 文件头写入映射的文件头区域
 	void write_head() noexcept;
-	void read_index(const FileHead &head) noexcept;
-	void write_index(FileHead &head) noexcept;
-	void read_node(MyaiNode::ptr node, std::streampos pos) noexcept;
-	void write_node(MyaiNode::ptr node, std::streampos pos) noexcept;
+	// 查找id所在的槽，不存在时返回空槽的位置
+	size_t probe_slot(nodeid_t id) const noexcept;
+	// 删除槽并把后续冲突的项前移，保持探测链连续
+	void erase_slot(size_t slot) noexcept;
+	bool read_node(MyaiNode::ptr node, PageSpan span);
+	// 从内存中的记录反序列化
+	static bool parse_node(const MyaiNode::ptr &node, const byte_t *data, size_t size);
+	void write_node(const String &data, PageSpan span) noexcept;
 
 	bool check_path_is_equal(String other) const noexcept;
 
 private:
 	const size_t m_node_max_num;// 最大节点数量
+	const size_t m_page_size;	// 新建文件的页大小
 	String m_current_path;		// 当前文件路径
 	FileHead m_head;			// 文件头
-	FileIndex m_index;			// 节点索引
 	std::fstream m_fs;			// 文件流
+	std::vector<byte_t> m_page_buf;// 读页缓冲
+
+	OpenMode m_mode = IOM_READ_WRITE;
+	MappedFile m_map;			 // 只读时为整个文件，读写时为文件头和索引区
+	IndexSlot *m_slots = nullptr;// 映射中的索引区，只读模式下不可写
+
+	std::map<pageid_t, pageid_t> m_free_spans;			 // 空闲段：首页 -> 页数
+	std::set<std::pair<pageid_t, pageid_t>> m_free_sizes;// 空闲段：(页数, 首页)，用于最佳适配
+	bool m_free_loaded = false;
 };
 
 MYAI_END
 
-#endif//MYAI_DAO_MYAIFILEIO_H
\ No newline at end of file
+#endif//MYAI_DAO_MYAIFILEIO_H
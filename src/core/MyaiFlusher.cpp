@@ -0,0 +1,148 @@
+#include "MyaiFlusher.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+MYAI_BEGIN
+
+MyaiFlusher::MyaiFlusher(MyaiDao::ptr dao, size_t max_pending, size_t batch_size)
+	: m_dao(dao),
+	  m_max_pending(std::max<size_t>(max_pending, 1)),
+	  m_batch_size(std::max<size_t>(batch_size, 1)),
+	  m_thread([this] { work(); }) {
+}
+
+MyaiFlusher::~MyaiFlusher() {
+	try {
+		flush();
+	} catch (const std::exception &e) {
+		// 析构时不能抛出，停止前写回线程还会再试一次
+		std::cerr << "flusher error: write back failed on destroy: " << e.what() << std::endl;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_work_cond.notify_all();
+	m_thread.join();
+}
+
+void MyaiFlusher::enqueue(MyaiNode::ptr node) {
+	if (!node) MYLIB_THROW("avg error:avg is nullptr");
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	++m_stat.enqueued;
+	auto fd_rt = m_pending.find(node->id());
+	if (fd_rt != m_pending.end()) {
+		fd_rt->second = node;
+		++m_stat.coalesced;
+		return;
+	}
+	if (m_pending.size() >= m_max_pending) {
+		++m_stat.stalls;
+		// 写回失败后不再处理请求，此时报告错误而不是一直等待
+		m_done_cond.wait(lock, [this] { return m_pending.size() < m_max_pending || m_error; });
+		if (m_pending.size() >= m_max_pending) rethrow_error(lock);
+	}
+	m_pending.emplace(node->id(), node);
+	lock.unlock();
+	m_work_cond.notify_one();
+}
+
+MyaiNode::ptr MyaiFlusher::reclaim(nodeid_t id) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_cond.wait(lock, [&] { return m_writing.find(id) == m_writing.end(); });
+
+	auto fd_rt = m_pending.find(id);
+	if (fd_rt == m_pending.end()) {
+		return nullptr;
+	}
+	MyaiNode::ptr node = fd_rt->second;
+	if (node->state() != MyaiNode::NDS_DESTROY) {
+		m_pending.erase(fd_rt);
+		m_done_cond.notify_all();
+	}
+	return node;
+}
+
+void MyaiFlusher::flush() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_work_cond.notify_one();
+	m_done_cond.wait(lock, [this] { return (m_pending.empty() && m_writing.empty()) || m_error; });
+	if (m_error) rethrow_error(lock);
+}
+
+MyaiFlusher::Statistics MyaiFlusher::statistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stat;
+}
+
+void MyaiFlusher::rethrow_error(std::unique_lock<std::mutex> &lock) {
+	// 清除错误后写回线程重新尝试未写出的节点
+	std::exception_ptr error = std::exchange(m_error, nullptr);
+	lock.unlock();
+	m_work_cond.notify_one();
+	std::rethrow_exception(error);
+}
+
+void MyaiFlusher::work() {
+	std::vector<MyaiNode::ptr> batch, written;
+	std::vector<nodeid_t> erased;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_work_cond.wait(lock, [this] { return m_stop || (!m_pending.empty() && !m_error); });
+			if (m_stop && (m_pending.empty() || m_error)) return;
+
+			// 取出一批，移入写出集合
+			for (auto it = m_pending.begin(); it != m_pending.end() && batch.size() < m_batch_size;) {
+				batch.push_back(it->second);
+				m_writing.emplace(it->first, it->second);
+				it = m_pending.erase(it);
+			}
+		}
+
+		// 删除和写入各交给存储一次，按段分组并合并相邻页的写入
+		for (auto &node: batch) {
+			if (node->m_state == MyaiNode::NDS_DESTROY) {
+				erased.push_back(node->id());
+			} else {
+				written.push_back(node);
+			}
+		}
+		std::exception_ptr error;
+		try {
+			if (!erased.empty()) m_dao->deleteMany(erased);
+			if (!written.empty()) m_dao->upsertMany(written);
+			for (auto &node: written) {
+				node->m_state = MyaiNode::NDS_SAVE;
+			}
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (error) {
+				// 节点保持脏状态放回待写表，期间有更新的请求时保留新的
+				for (auto &node: batch) {
+					m_pending.emplace(node->id(), node);
+				}
+				// 在锁内释放，错误对象只在持锁时增减引用
+				if (!m_error) m_error = std::move(error);
+				error = nullptr;
+			} else {
+				m_stat.written += batch.size();
+				++m_stat.batches;
+			}
+			m_writing.clear();
+		}
+		batch.clear();
+		erased.clear();
+		written.clear();
+		m_done_cond.notify_all();
+	}
+}
+
+MYAI_END
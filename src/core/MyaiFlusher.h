@@ -0,0 +1,70 @@
+#ifndef MYAI_CORE_MYAIFLUSHER_H
+#define MYAI_CORE_MYAIFLUSHER_H
+
+#include "MyaiDao.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+MYAI_BEGIN
+
+/**
+ * @brief 脏节点的后台写回
+ * @details 写入请求按id合并，后台线程按批写入 MyaiDao，写完后节点置为 NDS_SAVE；
+ *          等待写回的节点超过上限时 enqueue 阻塞（背压）。
+ *          入队后节点归写回线程所有，需要再次使用时通过 reclaim 取回。
+ *          写入失败时该批节点保持脏状态放回待写表，暂停写回，错误由下一次 flush 抛出。
+ */
+class MyaiFlusher {
+public:
+	using ptr								= std::shared_ptr<MyaiFlusher>;
+	constexpr static size_t DEF_MAX_PENDING = 0x4000;
+	constexpr static size_t DEF_BATCH_SIZE	= 0x100;
+
+	struct Statistics {
+		uint64 enqueued	 = 0;
+		uint64 coalesced = 0;// 被后续写入合并的次数
+		uint64 written	 = 0;
+		uint64 batches	 = 0;
+		uint64 stalls	 = 0;// 背压阻塞次数
+	};
+
+	MyaiFlusher(MyaiDao::ptr dao, size_t max_pending = DEF_MAX_PENDING, size_t batch_size = DEF_BATCH_SIZE);
+	~MyaiFlusher();
+
+	// 提交脏节点（或 NDS_DESTROY 节点），同id的未写请求被合并；背压时写回已失败则抛出该错误
+	void enqueue(MyaiNode::ptr node);
+	// 取回尚未写出的节点；正在写出时等待写完；删除请求不会被取消
+	MyaiNode::ptr reclaim(nodeid_t id);
+	// 屏障：等待当前所有请求写完，写回失败时抛出该错误并恢复写回
+	void flush();
+
+	Statistics statistics() const;
+
+private:
+	void work();
+	// 报告并清除写回错误，写回线程随后重试
+	void rethrow_error(std::unique_lock<std::mutex> &lock);
+
+private:
+	MyaiDao::ptr m_dao;
+	const size_t m_max_pending;
+	const size_t m_batch_size;
+
+	std::unordered_map<nodeid_t, MyaiNode::ptr> m_pending;
+	std::unordered_map<nodeid_t, MyaiNode::ptr> m_writing;// 正在写出的一批
+	mutable std::mutex m_mutex;
+	std::condition_variable m_work_cond;// 有新请求
+	std::condition_variable m_done_cond;// 一批写完
+	bool m_stop = false;
+	std::exception_ptr m_error;// 尚未报告的写回错误
+	Statistics m_stat;
+	std::thread m_thread;
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_MYAIFLUSHER_H
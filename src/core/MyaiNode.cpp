@@ -1,28 +1,91 @@
 #include "MyaiNode.h"
+#include "crc32.h"
 
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <cstring>
+
 MYAI_BEGIN
 
+static_assert(sizeof(Edge) == sizeof(nodeid_t) + sizeof(weight_t), "Edge must be tightly packed");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "MyaiNode record format requires a little-endian host"
+#endif
+
 void MyaiNode::serialize(std::ostream &out) const {
-	out << m_id << m_bias << m_state;
-	out << m_links.size();
+	std::vector<Edge> edges;
+	edges.reserve(m_links.size());
 	for (const auto &lk: m_links) {
-		out.write(reinterpret_cast<const char *>(&lk.second), sizeof(lk.second));
+		edges.emplace_back(lk.second);
 	}
+	// 按id排序写出，保证记录字节稳定且可被有序链接表直接归并
+	if (!std::is_sorted(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.id < b.id; })) {
+		std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.id < b.id; });
+	}
+
+	RecordHead head{};
+	head.length		 = static_cast<uint32>(record_size(edges.size()));
+	head.id			 = m_id;
+	head.bias		 = m_bias;
+	head.state		 = m_state;
+	head.link_num	 = static_cast<uint32>(edges.size());
+	head.applied_lsn = m_applied_lsn;
+
+	const auto *head_bytes = reinterpret_cast<const byte_t *>(&head);
+	head.crc			   = crc32::update(0, head_bytes + RECORD_CRC_OFFSET, sizeof(head) - RECORD_CRC_OFFSET);
+	head.crc			   = crc32::update(head.crc, edges.data(), edges.size() * sizeof(Edge));
+
+	out.write(head_bytes, sizeof(head));
+	out.write(reinterpret_cast<const char *>(edges.data()), static_cast<std::streamsize>(edges.size() * sizeof(Edge)));
 }
 
 void MyaiNode::deserialize(std::istream &in) {
-	in >> m_id;
-	in >> m_bias;
-	in >> *reinterpret_cast<enum_size *>(&m_state);
-	size_t size;
-	in >> size;
-	Edge edge;
-	for (size_t i = 0; i < size; ++i) {
-		in.read(reinterpret_cast<char *>(&edge), sizeof(edge));
-		m_links.emplace(edge);
+	RecordHead head{};
+	in.read(reinterpret_cast<char *>(&head), sizeof(head));
+	if (!in || head.length != record_size(head.link_num)) {
+		in.setstate(std::ios::failbit);
+		return;
 	}
+
+	// crc 覆盖整条记录，只能读完后校验；链接数组分块读取，
+	// 损坏的 link_num 在流结束处失败，分配不超过实际读到的字节
+	uint32 crc = crc32::update(0, reinterpret_cast<const byte_t *>(&head) + RECORD_CRC_OFFSET, sizeof(head) - RECORD_CRC_OFFSET);
+	std::vector<Edge> edges;
+	for (size_t pos = 0; pos < head.link_num;) {
+		const size_t n = std::min<size_t>(READ_CHUNK_EDGES, head.link_num - pos);
+		edges.resize(pos + n);
+		in.read(reinterpret_cast<char *>(edges.data() + pos), static_cast<std::streamsize>(n * sizeof(Edge)));
+		if (!in) return;
+		crc = crc32::update(crc, edges.data() + pos, n * sizeof(Edge));
+		pos += n;
+	}
+	if (crc != head.crc) {
+		in.setstate(std::ios::failbit);
+		return;
+	}
+
+	m_id		  = head.id;
+	m_bias		  = head.bias;
+	m_state		  = static_cast<State>(head.state);
+	m_applied_lsn = head.applied_lsn;
+	// 记录是节点的完整状态，替换原有链接
+	m_links.clear();
+	m_links.accumulate(edges.data(), edges.size(), 1.0f);
+}
+
+bool MyaiNode::make_view(const byte_t *data, size_t size, MyaiNodeView &view) {
+	RecordHead head{};
+	if (size < sizeof(head)) return false;
+	std::memcpy(&head, data, sizeof(head));
+	if (head.length != record_size(head.link_num) || size < head.length) return false;
+
+	view.id		  = head.id;
+	view.bias	  = head.bias;
+	view.state	  = static_cast<State>(head.state);
+	view.links	  = reinterpret_cast<const Edge *>(data + sizeof(head));
+	view.link_num = head.link_num;
+	return true;
 }
 
 MYAI_END
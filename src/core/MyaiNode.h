@@ -2,12 +2,15 @@
 #define MYAI_NODE_H_
 
 #include "Edge.h"
+#include "SlabPool.h"
 #include "define.h"
+#include <cstddef>
 #include <functional>
 
 
 MYAI_BEGIN
 
+struct MyaiNodeView;
 
 /**
  * @brief 用于保存节点
@@ -15,6 +18,8 @@ MYAI_BEGIN
 class MyaiNode : public ISerialize {
 	friend class MyaiDatabase;
 	friend class MyaiService;
+	friend class MyaiCache;
+	friend class MyaiFlusher;
 
 public:
 	constexpr static const size_t MAX_LINK_NUMS = 0x1000;
@@ -41,10 +46,22 @@ public:
 	MyaiNode(nodeid_t id, weight_t bias, State state, EdgeList &links) : m_id(id), m_bias(bias), m_state(state), m_links(links) {}
 	~MyaiNode() override = default;
 
+	// 从 SlabPool 分配节点，节点和引用计数在同一个槽中
+	template<typename... Args>
+	static ptr create(Args &&...args) {
+		return std::allocate_shared<MyaiNode>(SlabAllocator<MyaiNode>(), std::forward<Args>(args)...);
+	}
+
 	[[nodiscard]] auto bias() const { return m_bias; }
 	[[nodiscard]] auto id() const { return m_id; }
 	[[nodiscard]] auto state() const { return m_state; }
 	[[nodiscard]] const auto &links() const { return m_links; }
+	// links 中已包含的最后一条日志记录的序号，回放时不再重复累加
+	[[nodiscard]] lsn_t applied_lsn() const { return m_applied_lsn; }
+	// 是否有未写回硬盘的修改
+	[[nodiscard]] bool is_dirty() const { return m_state >= NDS_READY && m_state <= NDS_SYNC; }
+	// 估算的内存占用
+	[[nodiscard]] size_t memory_size() const { return sizeof(MyaiNode) + m_links.memory_size() + m_buffer.memory_size(); }
 
 	auto &links() { return m_links; }
 	auto &buffer() { return m_buffer; }
@@ -52,22 +69,61 @@ public:
 	void serialize(std::ostream &out) const override;
 	void deserialize(std::istream &in) override;
 
-	void for_each(const std::function<void(Edge &)> &cb) {
-		for (auto &link: m_links) {
+	// 在序列化数据上直接构造只读视图，不拷贝链接
+	// @note 只校验记录长度，不校验crc
+	static bool make_view(const byte_t *data, size_t size, MyaiNodeView &view);
+
+	// 记录总字节数（记录头+链接数组）
+	static size_t record_size(size_t link_num) { return sizeof(RecordHead) + link_num * sizeof(Edge); }
+
+	template<typename Fn>
+	void for_each(Fn &&cb) {
+		for (auto &&link: m_links) {
 			cb(link.second);
 		}
-		for (auto &link: m_buffer) {
+		for (auto &&link: m_buffer) {
 			cb(link.second);
 		}
 	}
 
 private:
+	/**
+	 * @brief 序列化记录头（小端、定长），其后紧跟 link_num 个按id升序的 Edge
+	 * @details crc 覆盖 id 字段起至记录末尾的全部字节
+	 */
+	struct RecordHead {
+		uint32 length;// 记录总长度
+		uint32 crc;
+		nodeid_t id;
+		weight_t bias;
+		enum_size state;
+		uint32 link_num;
+		lsn_t applied_lsn;
+	};
+	constexpr static size_t RECORD_CRC_OFFSET = offsetof(RecordHead, id);
+	// 反序列化时每次读取的边数，避免按损坏的 link_num 一次分配
+	constexpr static size_t READ_CHUNK_EDGES = 0x1000;
+
 	nodeid_t m_id;
 	weight_t m_bias;
 	State m_state;
 
 	EdgeList m_links;
 	EdgeList m_buffer;
+	lsn_t m_applied_lsn = 0;// 随记录保存
+	lsn_t m_buffer_lsn	= 0;// buffer 中最后一条日志记录的序号，不保存
+};
+
+/**
+ * @brief 节点的只读视图，links 直接指向映射文件中的记录
+ * @note 仅在对应段文件保持映射期间有效
+ */
+struct MyaiNodeView {
+	nodeid_t id			  = MyaiNode::NULL_ID;
+	weight_t bias		  = MyaiNode::NULL_WEIGHT;
+	MyaiNode::State state = MyaiNode::NDS_UNDEFINED;
+	const Edge *links	  = nullptr;
+	size_t link_num		  = 0;
 };
 
 
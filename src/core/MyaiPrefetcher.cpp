@@ -0,0 +1,115 @@
+#include "MyaiPrefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+MYAI_BEGIN
+
+MyaiPrefetcher::MyaiPrefetcher(MyaiDao::ptr dao, MyaiCache::ptr cache, size_t max_pending)
+	: m_dao(dao),
+	  m_cache(cache),
+	  m_max_pending(std::max<size_t>(max_pending, 1)),
+	  m_thread([this] { work(); }) {
+}
+
+MyaiPrefetcher::~MyaiPrefetcher() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_stat.dropped += m_pending.size();
+		m_pending.clear();
+	}
+	m_work_cond.notify_all();
+	m_thread.join();
+}
+
+void MyaiPrefetcher::enqueue(const EdgeList &frontier) {
+	std::vector<Edge> edges;
+	edges.reserve(frontier.size());
+	for (auto &&[id, edge]: frontier) {
+		edges.emplace_back(edge);
+	}
+	size_t dropped = 0;
+	if (edges.size() > m_max_pending) {
+		std::nth_element(edges.begin(), edges.begin() + m_max_pending, edges.end(),
+						 [](const Edge &a, const Edge &b) { return std::fabs(a.weight) > std::fabs(b.weight); });
+		dropped = edges.size() - m_max_pending;
+		edges.resize(m_max_pending);
+	}
+	// 按id排序，使同一段文件内的读取尽量连续
+	std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.id < b.id; });
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stat.requested += frontier.size();
+		m_stat.dropped += dropped + m_pending.size();
+		m_pending.swap(edges);
+	}
+	m_work_cond.notify_one();
+}
+
+void MyaiPrefetcher::drain() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_cond.wait(lock, [this] { return m_pending.empty() && !m_busy; });
+	if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+MyaiPrefetcher::Statistics MyaiPrefetcher::statistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stat;
+}
+
+void MyaiPrefetcher::work() {
+	std::vector<Edge> batch;
+	std::vector<nodeid_t> ids;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_work_cond.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+			if (m_stop) return;
+			batch.swap(m_pending);
+			m_busy = true;
+		}
+
+		Statistics stat;
+		std::exception_ptr error;
+		try {
+			const bool read_only = m_dao->isReadOnly();
+			for (auto &edge: batch) {
+				if (m_cache->contains(edge.id)) {
+					++stat.cached;
+				} else if (!read_only) {
+					ids.push_back(edge.id);
+				} else {
+					// 只读时激活直接读映射，只需让页提前进入内存
+					++(m_dao->prefetchById(edge.id) ? stat.loaded : stat.missed);
+				}
+			}
+			if (!ids.empty()) {
+				// 读写时一次批量加载进缓存
+				const size_t loaded = m_cache->load(ids);
+				stat.loaded += loaded;
+				stat.missed += ids.size() - loaded;
+			}
+		} catch (...) {
+			// 预读失败不影响激活（激活时会再次读取），错误留给 drain 报告
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stat.cached += stat.cached;
+			m_stat.loaded += stat.loaded;
+			m_stat.missed += stat.missed;
+			if (error && !m_error) m_error = std::move(error);
+			error = nullptr;
+			m_busy = false;
+		}
+		batch.clear();
+		ids.clear();
+		m_done_cond.notify_all();
+	}
+}
+
+MYAI_END
@@ -0,0 +1,64 @@
+#ifndef MYAI_CORE_MYAIPREFETCHER_H
+#define MYAI_CORE_MYAIPREFETCHER_H
+
+#include "MyaiCache.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+MYAI_BEGIN
+
+/**
+ * @brief 按激活结果预读节点
+ * @details 激活得到的下一轮前沿交给后台线程，已缓存的节点跳过：
+ *          只读映射模式下对节点记录所在的页发出预读建议，不占用缓存；
+ *          读写模式下把节点加载进缓存。
+ *          新的前沿替换尚未处理的旧请求，超过上限时只保留权重绝对值最大的节点。
+ */
+class MyaiPrefetcher {
+public:
+	using ptr								= std::shared_ptr<MyaiPrefetcher>;
+	constexpr static size_t DEF_MAX_PENDING = 0x1000;
+
+	struct Statistics {
+		uint64 requested = 0;
+		uint64 cached	 = 0;// 已在缓存中而跳过
+		uint64 dropped	 = 0;// 超过上限或被新前沿替换
+		uint64 loaded	 = 0;// 加载进缓存或发出预读建议
+		uint64 missed	 = 0;// 存储中不存在
+	};
+
+	MyaiPrefetcher(MyaiDao::ptr dao, MyaiCache::ptr cache, size_t max_pending = DEF_MAX_PENDING);
+	~MyaiPrefetcher();
+
+	// 提交下一轮前沿，不等待
+	void enqueue(const EdgeList &frontier);
+	// 等待已提交的请求处理完，其间预读失败时抛出第一个错误
+	void drain();
+
+	Statistics statistics() const;
+
+private:
+	void work();
+
+private:
+	MyaiDao::ptr m_dao;
+	MyaiCache::ptr m_cache;
+	const size_t m_max_pending;
+
+	std::vector<Edge> m_pending;
+	bool m_busy = false;// 后台线程正在处理一批
+	mutable std::mutex m_mutex;
+	std::condition_variable m_work_cond;
+	std::condition_variable m_done_cond;
+	bool m_stop = false;
+	std::exception_ptr m_error;// 尚未报告的预读错误
+	Statistics m_stat;
+	std::thread m_thread;
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_MYAIPREFETCHER_H
@@ -1,5 +1,7 @@
 #include "MyaiService.h"
 
+#include <algorithm>
+
 
 MYAI_BEGIN
 
@@ -7,40 +9,140 @@ MYAI_BEGIN
 
 MyaiNode::ptr MyaiService::createNode(weight_t bias) {
 
-	MyaiNode::ptr node = std::make_shared<MyaiNode>(m_alloc->allocate(), bias, MyaiNode::NDS_CREATE);
-	m_updata_nodes.emplace(node->m_id, node);
-	node->m_state = MyaiNode::NDS_READY;
+	MyaiNode::ptr node = MyaiNode::create(m_alloc->allocate(), bias, MyaiNode::NDS_CREATE);
+	node->m_state	   = MyaiNode::NDS_READY;
+	m_cache->put(node);
+	if (m_wal) m_wal->appendCreate(node->m_id, bias);
 	return node;
 }
 
 bool MyaiService::removeNodeById(nodeid_t _id) {
-	const nodeid_t &id		 = _id;
-	const auto fd_rt		 = m_updata_nodes.find(id);
-	const MyaiNode::ptr node = fd_rt != m_updata_nodes.end() ? fd_rt->second : m_dao->selectById(id);
+	const MyaiNode::ptr node = m_cache->get(_id);
 
 	if (node == nullptr) return false;
-	if (node->m_state != MyaiNode::NDS_READY) MYLIB_THROW("node state is not ready");
+	if (node->m_state < MyaiNode::NDS_READY || node->m_state > MyaiNode::NDS_SAVE) MYLIB_THROW("node state is not ready");
 
 	node->m_state = MyaiNode::NDS_DESTROY;
 	m_alloc->deallocate(node->m_id);
+	if (m_wal) m_wal->appendDelete(node->m_id);
 	return true;
 }
 
 MyaiNode::ptr MyaiService::getNodeById(nodeid_t id) {
-	auto fd_rt = m_updata_nodes.find(id);
-	if (fd_rt != m_updata_nodes.end()) {
-		return fd_rt->second;
+	return m_cache->get(id);
+}
+
+bool MyaiService::getNodeViewById(nodeid_t id, MyaiNodeView &view) {
+	if (m_cache->contains(id)) {
+		return false;
 	}
-	MyaiNode::ptr node = m_dao->selectById(id);
-	return node;
+	return m_dao->viewById(id, view);
+}
+
+size_t MyaiService::loadNodes(const std::vector<nodeid_t> &ids) {
+	// 只读时直接读映射，不占用缓存
+	if (m_dao->isReadOnly()) return 0;
+	return m_cache->load(ids);
+}
+
+size_t MyaiService::linkCount(nodeid_t id) {
+	size_t count = 0;
+	if (m_cache->visit(id, [&](MyaiNode &node) { count = node.links().size() + node.buffer().size(); })) return count;
+	// 快照不可变，先于需要加锁的段文件查找
+	GraphSnapshot::Row row;
+	if (m_dao->snapshotView(id, row)) return row.link_num;
+	MyaiNodeView view;
+	if (m_dao->viewById(id, view)) return view.link_num;
+	MyaiNode::ptr node = getNodeById(id);
+	return node == nullptr ? 0 : node->links().size() + node->buffer().size();
 }
 
 bool MyaiService::activatedNode(EdgeList::ptr out, Edge edge) {
+	return activate_into(*out, edge);
+}
+
+void MyaiService::activatedNodes(EdgeList::ptr out, const std::vector<Edge> &edges) {
+	// 读写模式下未缓存的节点先批量加载，激活时不再逐个读取
+	if (!m_dao->isReadOnly()) {
+		std::vector<nodeid_t> ids;
+		ids.reserve(edges.size());
+		for (auto &edge: edges) {
+			ids.push_back(edge.id);
+		}
+		loadNodes(ids);
+	}
+
+	if (edges.size() < PARALLEL_ACTIVATE_MIN) {
+		for (auto &edge: edges) {
+			activate_into(*out, edge);
+		}
+		return;
+	}
+
+	const size_t grain	   = std::max(ACTIVATE_GRAIN, (edges.size() + ACTIVATE_MAX_CHUNK - 1) / ACTIVATE_MAX_CHUNK);
+	const size_t chunk_num = (edges.size() + grain - 1) / grain;
+	// 局部表只在本次调用内使用，每块从自己的分配器分配，结束时整体丢弃
+	if (m_activate_arenas.size() < chunk_num) m_activate_arenas.resize(chunk_num);
+	std::vector<EdgeList> partials;
+	partials.reserve(chunk_num);
+	for (size_t i = 0; i < chunk_num; ++i) {
+		if (!m_activate_arenas[i]) m_activate_arenas[i] = std::make_unique<CycleArena>();
+		partials.emplace_back(m_activate_arenas[i].get());
+	}
+
+	// 没有线程池时按相同的分块和归并顺序串行执行，结果逐位相同
+	for_chunks(edges.size(), grain, [&](size_t chunk, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			activate_into(partials[chunk], edges[i]);
+		}
+	});
+
+	// 固定配对的树形归并：(0,1)(2,3)... -> (0,2)(4,6)...
+	for (size_t step = 1; step < chunk_num; step *= 2) {
+		const size_t pair_num = (chunk_num + 2 * step - 1) / (2 * step);
+		for_chunks(pair_num, 1, [&](size_t, size_t begin, size_t end) {
+			for (size_t p = begin; p < end; ++p) {
+				const size_t i = p * 2 * step, j = i + step;
+				if (j >= chunk_num) continue;
+				partials[i].insert(partials[j]);
+			}
+		});
+	}
+	out->insert(partials[0]);
+
+	partials.clear();
+	for (size_t i = 0; i < chunk_num; ++i) {
+		m_activate_arenas[i]->reset();
+	}
+}
+
+bool MyaiService::activate_into(EdgeList &out, const Edge &edge) {
+	// 已缓存的节点在分片锁内直接读取，不增减引用计数
+	bool found = false;
+	if (m_cache->visit(edge.id, [&](MyaiNode &node) {
+			found = true;
+			out.accumulate(node.links(), edge.weight);
+			out.accumulate(node.buffer(), edge.weight);
+		})) {
+		return found;
+	}
+
+	// 快照不可变，先于需要加锁的段文件查找
+	GraphSnapshot::Row row;
+	if (m_dao->snapshotView(edge.id, row)) {
+		out.accumulate(row.link_ids, row.link_weights, row.link_num, edge.weight);
+		return true;
+	}
+	MyaiNodeView view;
+	if (m_dao->viewById(edge.id, view)) {
+		out.accumulate(view.links, view.link_num, edge.weight);
+		return true;
+	}
+
 	MyaiNode::ptr node = getNodeById(edge.id);
 	if (node == nullptr) return false;
-	node->for_each([&](Edge &link) {
-		out->emplace(Edge{link.id, link.weight * edge.weight});
-	});
+	out.accumulate(node->links(), edge.weight);
+	out.accumulate(node->buffer(), edge.weight);
 	return true;
 }
 
@@ -50,10 +152,189 @@ void MyaiService::linkNode(nodeid_t id, Edge link) {
 		return;
 	}
 	node->buffer().emplace(link);
+	node->m_state = MyaiNode::NDS_READY;
+	touch(id);
+	if (m_wal) node->m_buffer_lsn = m_wal->appendLink(id, link);
 }
 
 void MyaiService::linkNode(MyaiNode::ptr node, EdgeList::ptr links) {
 	node->buffer().insert(links);
+	node->m_state = MyaiNode::NDS_READY;
+	touch(node->m_id);
+	if (m_wal) node->m_buffer_lsn = m_wal->appendLinks(node->m_id, *links);
+}
+
+void MyaiService::setNodeBias(nodeid_t id, weight_t bias) {
+	auto node = getNodeById(id);
+	if (node == nullptr) {
+		return;
+	}
+	node->m_bias  = bias;
+	node->m_state = MyaiNode::NDS_READY;
+	if (m_wal) m_wal->appendBias(id, bias);
+}
+
+MyaiService::ConsolidateResult MyaiService::consolidateLinks(const std::unordered_map<nodeid_t, LinkRule> &rules,
+																const PruneOptions &prune) {
+	std::vector<nodeid_t> ids;
+	{
+		std::lock_guard<std::mutex> lock(m_touched_mutex);
+		ids.swap(m_touched);
+	}
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+	auto find_rule = [&](nodeid_t id) -> const LinkRule * {
+		auto fd_rt = rules.find(id);
+		return fd_rt == rules.end() ? nullptr : &fd_rt->second;
+	};
+	// 每块单独统计，结束后按块序汇总
+	std::vector<ConsolidateResult> partials((ids.size() + CONSOLIDATE_GRAIN - 1) / CONSOLIDATE_GRAIN);
+	auto consolidate = [&](size_t chunk, size_t begin, size_t end) {
+		ConsolidateResult &result = partials[chunk];
+		for (size_t i = begin; i < end; ++i) {
+			auto node = getNodeById(ids[i]);
+			if (node == nullptr || node->m_state == MyaiNode::NDS_DESTROY || node->buffer().empty()) continue;
+
+			const LinkRule *rule = find_rule(node->m_id);
+			if (rule == nullptr) {
+				node->links().insert(node->buffer());
+			} else {
+				for (auto &&[id, edge]: node->buffer()) {
+					const weight_t weight = edge.weight + rule->attach_weight;
+					if (weight < rule->filter_weight) continue;
+					node->links().emplace(id, weight);
+				}
+			}
+			node->buffer().clear();
+			// 缓冲中的日志记录已合并进链接，节点落盘后回放时跳过
+			node->m_applied_lsn = std::max(node->m_applied_lsn, node->m_buffer_lsn);
+			result.pruned_links += node->links().prune(prune.max_links, prune.min_weight, &result.pruned_weight);
+			node->m_state = MyaiNode::NDS_READY;
+			++result.nodes;
+		}
+	};
+
+	for_chunks(ids.size(), CONSOLIDATE_GRAIN, consolidate);
+
+	ConsolidateResult total;
+	for (auto &result: partials) {
+		total.nodes += result.nodes;
+		total.pruned_links += result.pruned_links;
+		total.pruned_weight += result.pruned_weight;
+	}
+	m_consolidate_stat.nodes += total.nodes;
+	m_consolidate_stat.pruned_links += total.pruned_links;
+	m_consolidate_stat.pruned_weight += total.pruned_weight;
+	return total;
+}
+
+size_t MyaiService::openWal(const String &path, MyaiWal::Options options) {
+	if (m_dao->isReadOnly()) MYLIB_THROW("file error: wal is not supported in read only mode.");
+	m_wal = nullptr;
+	auto wal = std::make_shared<MyaiWal>(path, options);
+
+	MyaiWal::Replayer replayer;
+	replayer.on_create = [this](nodeid_t id, weight_t bias) {
+		m_alloc->occupy(id);
+		if (m_cache->get(id) != nullptr) return;
+		auto node	  = MyaiNode::create(id, bias, MyaiNode::NDS_CREATE);
+		node->m_state = MyaiNode::NDS_READY;
+		m_cache->put(node);
+	};
+	replayer.on_bias = [this](nodeid_t id, weight_t bias) { setNodeBias(id, bias); };
+	replayer.on_link = [this](nodeid_t id, lsn_t lsn, const Edge *edges, size_t n) {
+		auto node = getNodeById(id);
+		// 已合并进落盘链接的记录不再累加
+		if (node == nullptr || lsn <= node->m_applied_lsn) return;
+		node->buffer().accumulate(edges, n, 1.0f);
+		node->m_buffer_lsn = lsn;
+		node->m_state = MyaiNode::NDS_READY;
+		touch(id);
+	};
+	replayer.on_delete = [this](nodeid_t id) { removeNodeById(id); };
+
+	// 回放期间不记录日志
+	const size_t count = wal->replay(replayer);
+	m_wal			   = wal;
+	return count;
+}
+
+void MyaiService::commit() {
+	if (!m_wal) return;
+	m_wal->commit();
+	if (m_wal->needCheckpoint()) checkpoint();
+}
+
+void MyaiService::enablePrefetch(size_t max_pending) {
+	m_prefetcher = nullptr;
+	m_prefetcher = std::make_shared<MyaiPrefetcher>(m_dao, m_cache, max_pending);
+}
+
+size_t MyaiService::exportSnapshot(const String &path) {
+	flush();
+	return GraphSnapshot::save(*m_dao, path);
+}
+
+size_t MyaiService::attachSnapshot(const String &path) {
+	auto snapshot = std::make_shared<GraphSnapshot>();
+	snapshot->open(path);
+	m_dao->attachSnapshot(snapshot);
+	for (size_t i = 0; i < snapshot->node_num(); ++i) {
+		m_alloc->occupy(snapshot->node_ids()[i]);
+	}
+	return snapshot->node_num();
+}
+
+size_t MyaiService::importSnapshot(const String &path) {
+	if (m_dao->isReadOnly()) MYLIB_THROW("file error:file is read only");
+	GraphSnapshot snapshot;
+	snapshot.open(path);
+	// 保留快照中的状态直接写入存储，已缓存的同id节点一并替换
+	std::vector<MyaiNode::ptr> batch;
+	batch.reserve(std::min(snapshot.node_num(), IMPORT_BATCH));
+	// 快照行是节点的完整状态，日志中已有的同id链接记录不再回放到导入的节点上
+	const lsn_t applied_lsn = m_wal ? m_wal->lsn() : 0;
+	for (size_t i = 0; i < snapshot.node_num(); ++i) {
+		const auto row = snapshot.row(i);
+		EdgeList links;
+		links.accumulate(row.link_ids, row.link_weights, row.link_num, 1.0f);
+		m_alloc->occupy(row.id);
+		auto node			= MyaiNode::create(row.id, row.bias, row.state, links);
+		node->m_applied_lsn = applied_lsn;
+		if (m_cache->contains(row.id)) m_cache->put(node);
+		batch.push_back(std::move(node));
+		if (batch.size() == IMPORT_BATCH || i + 1 == snapshot.node_num()) {
+			m_dao->upsertMany(batch);
+			batch.clear();
+		}
+	}
+	checkpoint();
+	return snapshot.node_num();
+}
+
+void MyaiService::checkpoint() {
+	if (!m_wal) {
+		flush();
+		// 只读时节点不落盘，分配状态也不保存
+		if (!m_dao->isReadOnly()) {
+			m_dao->sync();
+			m_alloc->save();
+		}
+		return;
+	}
+	m_wal->commit();
+	flush();
+	// 日志清空前段文件和id分配状态都要落盘，否则断电后已提交的修改连同日志一起丢失
+	m_dao->sync();
+	m_alloc->save();
+	m_wal->truncate();
+	m_cache->for_each([this](const MyaiNode::ptr &node) {
+		if (node->m_state != MyaiNode::NDS_DESTROY && !node->buffer().empty()) {
+			node->m_buffer_lsn = m_wal->appendLinks(node->m_id, node->buffer());
+		}
+	});
+	m_wal->commit(true);
 }
 
 MYAI_END
@@ -1,9 +1,16 @@
 #ifndef MYAI_SERVICE_NODESERVICE_H
 #define MYAI_SERVICE_NODESERVICE_H
 
+#include "CycleArena.h"
 #include "IdAllocator.h"
+#include "MyaiCache.h"
 #include "MyaiDao.h"
-#include <unordered_map>
+#include "MyaiPrefetcher.h"
+#include "MyaiWal.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <limits>
 
 MYAI_BEGIN
 
@@ -14,10 +21,40 @@ class MyaiService {
 	friend class DriverManager;
 
 public:
-	using ptr = std::shared_ptr<MyaiService>;
+	using ptr								  = std::shared_ptr<MyaiService>;
+	// 激活边数少于该值时串行激活
+	constexpr static size_t PARALLEL_ACTIVATE_MIN = 256;
+	// 并行激活的最小分块大小和最大分块数
+	constexpr static size_t ACTIVATE_GRAIN		  = 64;
+	constexpr static size_t ACTIVATE_MAX_CHUNK	  = 64;
+	// 整理缓冲区时每块的节点数
+	constexpr static size_t CONSOLIDATE_GRAIN	  = 32;
+	// 导入快照时每批写入的节点数
+	constexpr static size_t IMPORT_BATCH		  = 1024;
+
+	// 缓冲边合并到链接时的规则：weight + attach_weight 小于 filter_weight 的边丢弃
+	struct LinkRule {
+		weight_t attach_weight = 0;
+		weight_t filter_weight = std::numeric_limits<weight_t>::lowest();
+	};
+	// 合并后每个节点的链接上限：只保留权重绝对值最大的 max_links 条，绝对值小于 min_weight 的丢弃
+	struct PruneOptions {
+		size_t max_links	= MyaiNode::MAX_LINK_NUMS;
+		weight_t min_weight = 0;
+	};
+	struct ConsolidateResult {
+		size_t nodes		   = 0;// 合并的节点数
+		size_t pruned_links	   = 0;// 被裁剪的链接数
+		weight_t pruned_weight = 0;// 被裁剪链接的权重绝对值之和
+	};
 
-	MyaiService(MyaiDao::ptr dao, IdAllocator::ptr id_alloc)
-		: m_dao(dao), m_alloc(id_alloc) {
+	MyaiService(MyaiDao::ptr dao, IdAllocator::ptr id_alloc,
+				size_t cache_budget = MyaiCache::DEF_MEMORY_BUDGET, ThreadPool::ptr pool = nullptr)
+		: m_dao(dao),
+		  m_alloc(id_alloc),
+		  m_flusher(dao->isReadOnly() ? nullptr : std::make_shared<MyaiFlusher>(dao)),
+		  m_cache(std::make_shared<MyaiCache>(dao, cache_budget, MyaiCache::DEF_SHARD_NUM, m_flusher)),
+		  m_pool(pool) {
 	}
 
 
@@ -29,21 +66,137 @@ public:
 
 	// 获取节点
 	MyaiNode::ptr getNodeById(nodeid_t id);
+	// 获取未修改节点的只读视图（仅只读映射模式），不构造EdgeList
+	bool getNodeViewById(nodeid_t id, MyaiNodeView &view);
+
+	// 读写模式下把未缓存的节点批量加载进缓存，返回加载的节点数；只读时不加载
+	size_t loadNodes(const std::vector<nodeid_t> &ids);
+	// 节点激活时会触及的链接数（链接+缓冲），节点不存在时为0
+	size_t linkCount(nodeid_t id);
 
 	bool activatedNode(EdgeList::ptr out, Edge edge);
+	/**
+	 * @brief 激活一批节点，结果累加到out
+	 * @details 各块先累加到独立的局部表，再按块序两两归并；
+	 *          分块只取决于edges的数量，结果与线程数以及有无线程池无关。
+	 *          与逐条累加相比求和顺序不同，只差浮点舍入。
+	 *          局部表从每块复用的 CycleArena 分配
+	 * @note 不可重入
+	 */
+	void activatedNodes(EdgeList::ptr out, const std::vector<Edge> &edges);
 
 	void linkNode(nodeid_t id, Edge link);
 	void linkNode(MyaiNode::ptr node, EdgeList::ptr links);
+	void setNodeBias(nodeid_t id, weight_t bias);
+
+	/**
+	 * @brief 把上次整理以来被 linkNode 修改的节点的缓冲区合并到链接
+	 * @details 节点去重后分块并行处理，每个节点只合并、标脏一次；
+	 *          规则只作用于所属节点自身的缓冲区，其他节点的缓冲边原样合并
+	 *          （指向临时节点的边在 linkNode 时已按规则计算过权重）
+	 *          合并后按 prune 裁剪链接，限制节点的内存和激活时的扇出
+	 * @param rules 按节点id给出的合并规则（如推理时的临时节点）
+	 * @note 调用期间不能并发调用 linkNode；合并不记入日志，之后应做检查点
+	 */
+	ConsolidateResult consolidateLinks(const std::unordered_map<nodeid_t, LinkRule> &rules, const PruneOptions &prune);
+	ConsolidateResult consolidateLinks(const std::unordered_map<nodeid_t, LinkRule> &rules) {
+		return consolidateLinks(rules, PruneOptions());
+	}
+
+	/**
+	 * @brief 打开预写日志并回放其中的修改
+	 * @details 之后的节点修改都会先追加到日志，commit 时一并落盘
+	 * @return 回放的记录数
+	 */
+	size_t openWal(const String &path, MyaiWal::Options options = {});
+	// 提交本轮的修改（组提交），日志过大时自动做检查点
+	void commit();
+	/**
+	 * @brief 检查点：脏节点写出，段文件和id分配状态同步到磁盘后清空日志
+	 * @details 缓冲区不随节点记录保存，清空后重新记入日志
+	 */
+	void checkpoint();
+
+	/**
+	 * @brief 把整图导出为 CSR 快照
+	 * @details 先写回缓存中的脏节点，缓冲区不导出
+	 * @return 导出的节点数
+	 */
+	size_t exportSnapshot(const String &path);
+	/**
+	 * @brief 只读映射模式下附加快照，激活和查询时先于段文件查找，并标记id已占用
+	 * @details 只映射快照文件，不导入段文件；须在推理开始前调用
+	 * @return 快照中的节点数
+	 */
+	size_t attachSnapshot(const String &path);
+	/**
+	 * @brief 导入快照中的所有节点，覆盖同id的节点，并标记id已占用
+	 * @details 节点保留快照中的状态分批直接写入存储，不记入日志，完成后做检查点
+	 * @return 导入的节点数
+	 */
+	size_t importSnapshot(const String &path);
+
+	// 将缓存中的脏节点写回存储，返回时已落盘
+	void flush() { m_cache->flush(); }
+	MyaiCache::Statistics cacheStatistics() const { return m_cache->statistics(); }
+	MyaiFlusher::Statistics flusherStatistics() const {
+		return m_flusher ? m_flusher->statistics() : MyaiFlusher::Statistics{};
+	}
+	// 历次整理的累计结果
+	ConsolidateResult consolidateStatistics() const { return m_consolidate_stat; }
+
+	/**
+	 * @brief 开启后台预读，之后激活得到的下一轮前沿会提前读入
+	 * @param max_pending 每轮最多预读的节点数
+	 */
+	void enablePrefetch(size_t max_pending = MyaiPrefetcher::DEF_MAX_PENDING);
+	// 提交下一轮前沿，未开启预读时忽略
+	void prefetch(const EdgeList &frontier) {
+		if (m_prefetcher) m_prefetcher->enqueue(frontier);
+	}
+	// 等待已提交的预读完成，预读失败时抛出该错误
+	void drainPrefetch() {
+		if (m_prefetcher) m_prefetcher->drain();
+	}
+	MyaiPrefetcher::Statistics prefetchStatistics() const {
+		return m_prefetcher ? m_prefetcher->statistics() : MyaiPrefetcher::Statistics{};
+	}
 
 private:
+	bool activate_into(EdgeList &out, const Edge &edge);
+	// 按 ThreadPool::parallel_for 的分块执行，没有线程池时按块序串行
+	template<typename Fn>
+	void for_chunks(size_t n, size_t grain, Fn &&fn) {
+		if (m_pool) {
+			m_pool->parallel_for(n, grain, fn);
+			return;
+		}
+		for (size_t chunk = 0, begin = 0; begin < n; ++chunk, begin += grain) {
+			fn(chunk, begin, std::min(begin + grain, n));
+		}
+	}
+
 	nodeid_t applyId(size_t size) {
 		return m_alloc->allocate(size);
 	}
+	void touch(nodeid_t id) {
+		std::lock_guard<std::mutex> lock(m_touched_mutex);
+		m_touched.push_back(id);
+	}
 
 private:
-	std::unordered_map<nodeid_t, MyaiNode::ptr> m_updata_nodes;
 	MyaiDao::ptr m_dao;
 	IdAllocator::ptr m_alloc;
+	MyaiFlusher::ptr m_flusher;
+	MyaiCache::ptr m_cache;
+	ThreadPool::ptr m_pool;
+	MyaiWal::ptr m_wal;
+	MyaiPrefetcher::ptr m_prefetcher;// 先于缓存析构
+
+	std::mutex m_touched_mutex;
+	std::vector<nodeid_t> m_touched;// 缓冲区被修改的节点，可能重复
+	ConsolidateResult m_consolidate_stat;
+	std::vector<std::unique_ptr<CycleArena>> m_activate_arenas;// 并行激活时每块一个
 };
 
 MYAI_END
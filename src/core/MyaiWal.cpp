@@ -0,0 +1,242 @@
+#include "MyaiWal.h"
+#include "crc32.h"
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef MYLIB_WINDOWS
+#include <io.h>
+#elif MYLIB_LINUX
+#include <unistd.h>
+#endif
+
+MYAI_BEGIN
+
+MyaiWal::MyaiWal(String path, Options options)
+	: m_path(path), m_options(options) {
+	m_file = std::fopen(m_path.c_str(), "ab");
+	if (!m_file) MYLIB_THROW("file error: wal open failed.");
+	std::fseek(m_file, 0, SEEK_END);
+	m_file_size = static_cast<size_t>(std::ftell(m_file));
+}
+
+MyaiWal::~MyaiWal() {
+	if (!m_file) return;
+	try {
+		commit(true);
+	} catch (const std::exception &e) {
+		// 析构时不能抛出，未写出的记录只能丢弃
+		std::cerr << "wal error: commit failed on destroy: " << e.what() << std::endl;
+	}
+	std::fclose(m_file);
+}
+
+size_t MyaiWal::replay(const Replayer &replayer) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	write_buffer();
+
+	std::vector<byte_t> data(m_file_size);
+	{
+		std::FILE *in = std::fopen(m_path.c_str(), "rb");
+		if (!in) MYLIB_THROW("file error: wal open failed.");
+		data.resize(std::fread(data.data(), 1, data.size(), in));
+		std::fclose(in);
+	}
+
+	size_t pos = 0, count = 0;
+	lsn_t lsn = 0;
+	std::vector<Edge> edges;
+	while (pos + sizeof(RecordHead) <= data.size()) {
+		RecordHead head;
+		std::memcpy(&head, data.data() + pos, sizeof(head));
+		const byte_t *payload = data.data() + pos + sizeof(head);
+		if (pos + sizeof(head) + head.length > data.size()) break;
+		if (crc32::update(crc32::update(0, &head.type, sizeof(head.type)), payload, head.length) != head.crc) break;
+
+		// 校验通过但长度与类型不符的记录视为损坏，与校验失败一样截断
+		if (!check_length(head)) break;
+		if (head.type == WAL_LINKS) {
+			uint32 n;
+			std::memcpy(&n, payload + sizeof(nodeid_t), sizeof(n));
+			if (head.length != sizeof(nodeid_t) + sizeof(n) + size_t(n) * sizeof(Edge)) break;
+		}
+		if (head.type == WAL_BASE) {
+			std::memcpy(&lsn, payload, sizeof(lsn));
+			pos += sizeof(head) + head.length;
+			continue;
+		}
+		++lsn;
+
+		nodeid_t id;
+		weight_t bias;
+		std::memcpy(&id, payload, sizeof(id));
+		switch (head.type) {
+			case WAL_CREATE:
+			case WAL_BIAS:
+				std::memcpy(&bias, payload + sizeof(id), sizeof(bias));
+				if (head.type == WAL_CREATE && replayer.on_create) replayer.on_create(id, bias);
+				if (head.type == WAL_BIAS && replayer.on_bias) replayer.on_bias(id, bias);
+				break;
+			case WAL_LINK:
+			case WAL_LINKS: {
+				uint32 n	= 1;
+				size_t off	= sizeof(id);
+				if (head.type == WAL_LINKS) {
+					std::memcpy(&n, payload + off, sizeof(n));
+					off += sizeof(n);
+				}
+				edges.resize(n);
+				std::memcpy(static_cast<void *>(edges.data()), payload + off, n * sizeof(Edge));
+				if (replayer.on_link) replayer.on_link(id, lsn, edges.data(), edges.size());
+				break;
+			}
+			case WAL_DELETE:
+				if (replayer.on_delete) replayer.on_delete(id);
+				break;
+			default:
+				break;
+		}
+		pos += sizeof(head) + head.length;
+		++count;
+	}
+
+	// 截断末尾不完整的记录
+	if (pos < m_file_size) {
+		std::fclose(m_file);
+		std::filesystem::resize_file(m_path, pos);
+		m_file = std::fopen(m_path.c_str(), "ab");
+		if (!m_file) MYLIB_THROW("file error: wal open failed.");
+		m_file_size = pos;
+	}
+
+	// 崩溃前可能分配过未落盘的序号，新的序号从下一段开始，起点先落盘
+	m_lsn = m_written_lsn = ((lsn >> 32) + 1) << 32;
+	append_base(m_lsn);
+	write_buffer();
+	sync_file();
+	return count;
+}
+
+bool MyaiWal::check_length(const RecordHead &head) noexcept {
+	switch (head.type) {
+		case WAL_CREATE:
+		case WAL_BIAS: return head.length == sizeof(nodeid_t) + sizeof(weight_t);
+		case WAL_LINK: return head.length == sizeof(nodeid_t) + sizeof(Edge);
+		case WAL_LINKS: return head.length >= sizeof(nodeid_t) + sizeof(uint32) && (head.length - sizeof(nodeid_t) - sizeof(uint32)) % sizeof(Edge) == 0;
+		case WAL_DELETE: return head.length == sizeof(nodeid_t);
+		case WAL_BASE: return head.length == sizeof(lsn_t);
+		default: return false;
+	}
+}
+
+lsn_t MyaiWal::appendLink(nodeid_t id, const Edge &edge) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	begin_record(WAL_LINK);
+	put(id);
+	put(edge);
+	end_record();
+	return m_lsn;
+}
+
+lsn_t MyaiWal::appendLinks(nodeid_t id, const EdgeList &links) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	begin_record(WAL_LINKS);
+	put(id);
+	put(static_cast<uint32>(links.size()));
+	for (const auto &link: links) {
+		put(Edge(link.second));
+	}
+	end_record();
+	return m_lsn;
+}
+
+void MyaiWal::appendDelete(nodeid_t id) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	begin_record(WAL_DELETE);
+	put(id);
+	end_record();
+}
+
+lsn_t MyaiWal::lsn() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_lsn;
+}
+
+void MyaiWal::commit(bool force) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	write_buffer();
+	++m_commits;
+	if (force || (m_options.sync_every > 0 && m_commits % m_options.sync_every == 0)) {
+		sync_file();
+	}
+}
+
+void MyaiWal::truncate() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::fclose(m_file);
+	m_file = std::fopen(m_path.c_str(), "wb");
+	if (!m_file) MYLIB_THROW("file error: wal open failed.");
+	m_file_size = 0;
+	// 截断前已追加但未提交的记录保留，序号接在已写出的记录之后
+	std::vector<byte_t> pending;
+	pending.swap(m_buffer);
+	append_base(m_written_lsn);
+	m_buffer.insert(m_buffer.end(), pending.begin(), pending.end());
+	write_buffer();
+	sync_file();
+}
+
+void MyaiWal::append_node(RecordType type, nodeid_t id, weight_t bias) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	begin_record(type);
+	put(id);
+	put(bias);
+	end_record();
+}
+
+void MyaiWal::append_base(lsn_t base) {
+	begin_record(WAL_BASE);
+	put(base);
+	end_record();
+}
+
+void MyaiWal::begin_record(RecordType type) {
+	if (type != WAL_BASE) ++m_lsn;
+	m_record = m_buffer.size();
+	put(RecordHead{0, 0, type});
+}
+
+void MyaiWal::end_record() {
+	RecordHead head;
+	std::memcpy(&head, m_buffer.data() + m_record, sizeof(head));
+	const byte_t *payload = m_buffer.data() + m_record + sizeof(head);
+	head.length			  = static_cast<uint32>(m_buffer.size() - m_record - sizeof(head));
+	head.crc			  = crc32::update(crc32::update(0, &head.type, sizeof(head.type)), payload, head.length);
+	std::memcpy(m_buffer.data() + m_record, &head, sizeof(head));
+
+	if (m_buffer.size() >= m_options.buffer_limit) {
+		write_buffer();
+	}
+}
+
+void MyaiWal::write_buffer() {
+	if (m_buffer.empty()) return;
+	if (std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size()) {
+		MYLIB_THROW("file error: wal write failed.");
+	}
+	m_file_size += m_buffer.size();
+	m_written_lsn = m_lsn;
+	m_buffer.clear();
+}
+
+void MyaiWal::sync_file() {
+	std::fflush(m_file);
+#ifdef MYLIB_WINDOWS
+	_commit(_fileno(m_file));
+#elif MYLIB_LINUX
+	fsync(fileno(m_file));
+#endif
+}
+
+MYAI_END
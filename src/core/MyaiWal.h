@@ -0,0 +1,118 @@
+#ifndef MYAI_CORE_MYAIWAL_H
+#define MYAI_CORE_MYAIWAL_H
+
+#include "Edge.h"
+#include "define.h"
+
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+MYAI_BEGIN
+
+/**
+ * @brief 节点修改的预写日志
+ * @details 记录格式：length | crc | type | 负载，crc 覆盖 type 和负载。
+ *          append 只写入内存缓冲，commit 一次写出（组提交），
+ *          每 sync_every 次提交做一次 fsync。
+ *          除 WAL_BASE 外每条记录有隐含的序号(lsn)：前一条记录的序号加1，
+ *          WAL_BASE 给出其后记录的起点；节点记录保存已合并的序号，回放时跳过已落盘的链接。
+ */
+class MyaiWal {
+public:
+	using ptr = std::shared_ptr<MyaiWal>;
+
+	enum RecordType : uint32 {
+		WAL_CREATE,// id | bias
+		WAL_BIAS,  // id | bias
+		WAL_LINK,  // id | Edge
+		WAL_LINKS, // id | n | Edge[n]
+		WAL_DELETE,// id
+		WAL_BASE,  // lsn：其后记录的序号从它加1开始
+	};
+
+	struct Options {
+		size_t sync_every	   = 1;		   // 每多少次提交fsync一次，0表示从不
+		size_t buffer_limit	   = 1ULL << 20;// 缓冲超过该大小时提前写出
+		size_t checkpoint_size = 64ULL << 20;// 日志超过该大小时建议做检查点
+	};
+
+	// 回放时每条记录的回调
+	struct Replayer {
+		std::function<void(nodeid_t, weight_t)> on_create;
+		std::function<void(nodeid_t, weight_t)> on_bias;
+		std::function<void(nodeid_t, lsn_t, const Edge *, size_t)> on_link;
+		std::function<void(nodeid_t)> on_delete;
+	};
+
+	MyaiWal(String path, Options options);
+	MyaiWal(String path) : MyaiWal(path, Options()) {}
+	~MyaiWal();
+
+	/**
+	 * @brief 回放日志中所有完整的记录
+	 * @details 遇到不完整、校验失败、长度与类型不符或未知类型的记录时截断其后的内容。
+	 *          回放后序号跳到下一个 2^32 的整数倍并立即落盘，
+	 *          崩溃前分配过但未落盘的序号不会再被使用
+	 * @note 打开后须先回放再追加记录
+	 * @return 回放的记录数
+	 */
+	size_t replay(const Replayer &replayer);
+
+	void appendCreate(nodeid_t id, weight_t bias) { append_node(WAL_CREATE, id, bias); }
+	void appendBias(nodeid_t id, weight_t bias) { append_node(WAL_BIAS, id, bias); }
+	// 返回记录的序号
+	lsn_t appendLink(nodeid_t id, const Edge &edge);
+	lsn_t appendLinks(nodeid_t id, const EdgeList &links);
+	void appendDelete(nodeid_t id);
+	// 最后追加的记录的序号
+	lsn_t lsn();
+
+	// 写出缓冲（组提交），按 sync_every 决定是否fsync；force为真时总是fsync
+	void commit(bool force = false);
+	// 检查点完成后清空日志
+	void truncate();
+
+	size_t size() const { return m_file_size + m_buffer.size(); }
+	bool needCheckpoint() const { return size() >= m_options.checkpoint_size; }
+
+private:
+	struct RecordHead {
+		uint32 length;// 负载长度
+		uint32 crc;
+		uint32 type;
+	};
+
+	// 负载长度是否符合记录类型，未知类型返回false
+	static bool check_length(const RecordHead &head) noexcept;
+	void append_node(RecordType type, nodeid_t id, weight_t bias);
+	void append_base(lsn_t base);
+	void begin_record(RecordType type);
+	void end_record();
+	template<typename T>
+	void put(const T &val) {
+		const auto *p = reinterpret_cast<const byte_t *>(&val);
+		m_buffer.insert(m_buffer.end(), p, p + sizeof(T));
+	}
+
+	void write_buffer();
+	void sync_file();
+
+private:
+
+	String m_path;
+	Options m_options;
+	std::FILE *m_file	= nullptr;
+	size_t m_file_size	= 0;
+	size_t m_commits	= 0;
+	size_t m_record		= 0;// 当前记录在缓冲中的起始位置
+	lsn_t m_lsn			= 0;// 最后追加的记录的序号
+	lsn_t m_written_lsn = 0;// 最后写出到文件的记录的序号
+	std::vector<byte_t> m_buffer;
+	std::mutex m_mutex;
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_MYAIWAL_H
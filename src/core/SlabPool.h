@@ -0,0 +1,147 @@
+#ifndef MYAI_CORE_SLABPOOL_H
+#define MYAI_CORE_SLABPOOL_H
+
+#include "define.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+MYAI_BEGIN
+
+/**
+ * @brief 定长对象的分片池
+ * @details 内存按 SLAB_SIZE 的大块向系统申请，切成 Size 字节的槽。
+ *          每个线程有自己的空闲链表，分配和释放都不加锁；
+ *          本线程空闲槽超过 2*BATCH_SIZE 时把一批交回全局，空了时从全局取一批，
+ *          一个线程分配、另一个线程释放的对象（如写回线程释放的节点）经全局批次被再次使用。
+ *          槽不归还系统，池的内存只增不减。
+ */
+template<size_t Size, size_t Align>
+class SlabPool {
+public:
+	constexpr static size_t SLOT_SIZE  = (std::max(Size, sizeof(void *)) + Align - 1) / Align * Align;
+	constexpr static size_t SLAB_SIZE  = 64ULL << 10;
+	constexpr static size_t BATCH_SIZE = 64;
+	static_assert(SLOT_SIZE <= SLAB_SIZE, "slab pool slot is too large");
+
+	static void *allocate() {
+		Local &local = local_cache();
+		if (local.head == nullptr) refill(local);
+		FreeSlot *slot = local.head;
+		local.head	   = slot->next;
+		--local.count;
+		return slot;
+	}
+
+	static void deallocate(void *ptr) {
+		Local &local = local_cache();
+		auto *slot	 = static_cast<FreeSlot *>(ptr);
+		slot->next	 = local.head;
+		local.head	 = slot;
+		if (++local.count >= 2 * BATCH_SIZE) release(local, BATCH_SIZE);
+	}
+
+private:
+	struct FreeSlot {
+		FreeSlot *next;
+	};
+	// 全局的空闲批次，每批是一条槽链表，通常 BATCH_SIZE 个（线程退出时可能不足）
+	struct Global {
+		std::mutex mutex;
+		std::vector<FreeSlot *> batches;
+		std::vector<std::unique_ptr<byte_t[]>> slabs;
+	};
+	struct Local {
+		FreeSlot *head = nullptr;
+		size_t count   = 0;
+		// 线程退出时空闲槽全部交回全局
+		~Local() {
+			while (count > 0) release(*this, std::min(count, BATCH_SIZE));
+		}
+	};
+
+	static Global &global() {
+		// 不析构：其他静态对象析构时可能仍在释放槽
+		static Global *instance = new Global();
+		return *instance;
+	}
+	static Local &local_cache() {
+		thread_local Local local;
+		return local;
+	}
+
+	static void refill(Local &local) {
+		Global &g = global();
+		std::lock_guard<std::mutex> lock(g.mutex);
+		if (!g.batches.empty()) {
+			local.head = g.batches.back();
+			g.batches.pop_back();
+			local.count = batch_size(local.head);
+			return;
+		}
+
+		// 新的大块切成槽，全部挂到本线程
+		auto slab	 = std::make_unique<byte_t[]>(SLAB_SIZE + Align);
+		auto base	 = reinterpret_cast<uintptr_t>(slab.get());
+		byte_t *data = slab.get() + ((base + Align - 1) / Align * Align - base);
+		g.slabs.push_back(std::move(slab));
+		for (size_t i = SLAB_SIZE / SLOT_SIZE; i > 0; --i) {
+			auto *slot = reinterpret_cast<FreeSlot *>(data + (i - 1) * SLOT_SIZE);
+			slot->next = local.head;
+			local.head = slot;
+			++local.count;
+		}
+	}
+
+	static void release(Local &local, size_t n) {
+		FreeSlot *head = local.head, *tail = head;
+		for (size_t i = 1; i < n; ++i) tail = tail->next;
+		local.head = tail->next;
+		local.count -= n;
+		tail->next = nullptr;
+
+		Global &g = global();
+		std::lock_guard<std::mutex> lock(g.mutex);
+		g.batches.push_back(head);
+	}
+
+	static size_t batch_size(FreeSlot *head) {
+		size_t n = 0;
+		for (; head != nullptr; head = head->next) ++n;
+		return n;
+	}
+};
+
+/**
+ * @brief 单个对象从 SlabPool 分配的分配器，可用于 std::allocate_shared
+ * @note 一次分配多个对象时退化为 std::allocator
+ */
+template<typename T>
+class SlabAllocator {
+public:
+	using value_type = T;
+
+	SlabAllocator() = default;
+	template<typename U>
+	SlabAllocator(const SlabAllocator<U> &) noexcept {}
+
+	T *allocate(size_t n) {
+		if (n != 1) return std::allocator<T>().allocate(n);
+		return static_cast<T *>(SlabPool<sizeof(T), alignof(T)>::allocate());
+	}
+	void deallocate(T *ptr, size_t n) noexcept {
+		if (n != 1) return std::allocator<T>().deallocate(ptr, n);
+		SlabPool<sizeof(T), alignof(T)>::deallocate(ptr);
+	}
+
+	template<typename U>
+	bool operator==(const SlabAllocator<U> &) const noexcept { return true; }
+	template<typename U>
+	bool operator!=(const SlabAllocator<U> &) const noexcept { return false; }
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_SLABPOOL_H
@@ -0,0 +1,93 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+
+MYAI_BEGIN
+
+ThreadPool::ThreadPool(size_t thread_num) {
+	thread_num = std::max<size_t>(thread_num, 1);
+	m_threads.reserve(thread_num);
+	for (size_t i = 0; i < thread_num; ++i) {
+		m_threads.emplace_back([this] { work(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_cond.notify_all();
+	for (auto &t: m_threads) {
+		t.join();
+	}
+}
+
+void ThreadPool::submit(Task task) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.emplace_back(std::move(task));
+	}
+	m_cond.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, const Range &fn) {
+	if (n == 0) return;
+	grain				   = std::max<size_t>(grain, 1);
+	const size_t chunk_num = (n + grain - 1) / grain;
+	if (chunk_num == 1) {
+		fn(0, 0, n);
+		return;
+	}
+
+	struct State {
+		std::atomic<size_t> next{0};
+		size_t done = 0;
+		std::exception_ptr error;
+		std::mutex mutex;
+		std::condition_variable cond;
+	};
+	auto state = std::make_shared<State>();
+
+	// 领取并执行块，直到没有剩余
+	auto run = [state, chunk_num, n, grain, &fn] {
+		size_t chunk;
+		while ((chunk = state->next.fetch_add(1)) < chunk_num) {
+			const size_t begin = chunk * grain;
+			try {
+				fn(chunk, begin, std::min(begin + grain, n));
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (!state->error) state->error = std::current_exception();
+			}
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (++state->done == chunk_num) state->cond.notify_all();
+		}
+	};
+
+	const size_t helper_num = std::min(m_threads.size(), chunk_num - 1);
+	for (size_t i = 0; i < helper_num; ++i) {
+		submit(run);
+	}
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->cond.wait(lock, [&] { return state->done == chunk_num; });
+	if (state->error) std::rethrow_exception(state->error);
+}
+
+void ThreadPool::work() {
+	while (true) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+			if (m_stop && m_tasks.empty()) return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+MYAI_END
@@ -0,0 +1,54 @@
+#ifndef MYAI_CORE_THREADPOOL_H
+#define MYAI_CORE_THREADPOOL_H
+
+#include "define.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+MYAI_BEGIN
+
+/**
+ * @brief 固定大小的工作线程池
+ */
+class ThreadPool {
+public:
+	using ptr	= std::shared_ptr<ThreadPool>;
+	using Task	= std::function<void()>;
+	// fn(chunk, begin, end)：处理第chunk块，范围[begin, end)
+	using Range = std::function<void(size_t, size_t, size_t)>;
+
+	explicit ThreadPool(size_t thread_num = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &)			  = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	void submit(Task task);
+
+	/**
+	 * @brief 把[0, n)按grain切成固定的块并行执行，阻塞到全部完成
+	 * @note 块的划分只取决于n和grain，与线程数无关；调用线程也参与执行
+	 */
+	void parallel_for(size_t n, size_t grain, const Range &fn);
+
+	size_t size() const { return m_threads.size(); }
+
+private:
+	void work();
+
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<Task> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	bool m_stop = false;
+};
+
+MYAI_END
+
+#endif//MYAI_CORE_THREADPOOL_H
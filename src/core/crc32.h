@@ -0,0 +1,65 @@
+#ifndef MYAI_CRC32_H_
+#define MYAI_CRC32_H_
+
+#include "define.h"
+
+#if defined(__SSE4_2__) && (defined(__x86_64__) || defined(_M_X64))
+#define MYAI_CRC32_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+#include <array>
+#include <cstring>
+
+MYAI_BEGIN
+
+/**
+ * @brief CRC-32C（Castagnoli）校验
+ * @note 支持SSE4.2时使用硬件crc32指令，否则查表
+ */
+namespace crc32 {
+
+inline const std::array<uint32, 256> &table() {
+	static const std::array<uint32, 256> s_table = [] {
+		std::array<uint32, 256> t{};
+		for (uint32 i = 0; i < 256; ++i) {
+			uint32 c = i;
+			for (int k = 0; k < 8; ++k) {
+				c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+			}
+			t[i] = c;
+		}
+		return t;
+	}();
+	return s_table;
+}
+
+// 在crc基础上继续计算data，首次调用传0
+inline uint32 update(uint32 crc, const void *data, size_t size) {
+	auto *p = static_cast<const unsigned char *>(data);
+	crc		= ~crc;
+#ifdef MYAI_CRC32_SSE42
+	uint64_t c = crc;
+	for (; size >= 8; size -= 8, p += 8) {
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = static_cast<uint32>(c);
+	for (; size > 0; --size, ++p) {
+		crc = _mm_crc32_u8(crc, *p);
+	}
+#else
+	const auto &t = table();
+	for (; size > 0; --size, ++p) {
+		crc = t[(crc ^ *p) & 0xFF] ^ (crc >> 8);
+	}
+#endif
+	return ~crc;
+}
+
+}// namespace crc32
+
+MYAI_END
+
+#endif// !MYAI_CRC32_H_
@@ -16,6 +16,7 @@ using nodeid_t = uint32;
 typedef nodeid_t noid_t, edgeid_t;
 using weight_t = float;
 using byte_t   = char;
+using lsn_t	   = uint64;// 预写日志中记录的序号，单调递增
 
 class ISerialize {
 public:
@@ -4,9 +4,42 @@
 
 
 int main(int argc, const char **argv) {
-	MYAI_SPACE::MyaiController controller(10);
-	controller.init();
+	// myai --upgrade <data_path>：一次性升级旧版本数据文件
+	if (argc == 3 && std::string(argv[1]) == "--upgrade") {
+		size_t count = MYAI_SPACE::MyaiDao::upgrade(argv[2]);
+		std::cout << "upgraded " << count << " file(s)." << std::endl;
+		return 0;
+	}
+
+	// myai [--text <path|->] [--vocab <path>] [--audio <path|->] [--screen <y4m>] [--camera <y4m>]：启用对应驱动
+	//      [--import <snapshot>]：启动后导入快照  [--export <snapshot>]：退出前导出快照
+	//      [--snapshot <snapshot>]：只读启动并附加快照，不导入
+	MYAI_SPACE::DriverConfig driver_config;
+	std::string import_path, export_path, snapshot_path;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string arg = argv[i];
+		if (arg == "--import") import_path = argv[i + 1];
+		else if (arg == "--export") export_path = argv[i + 1];
+		else if (arg == "--snapshot") snapshot_path = argv[i + 1];
+		else if (arg == "--text") driver_config.text_input = argv[i + 1];
+		else if (arg == "--vocab") driver_config.text_vocabulary = argv[i + 1];
+		else if (arg == "--audio") driver_config.audio_input = argv[i + 1];
+		else if (arg == "--screen") driver_config.screen_input = argv[i + 1];
+		else if (arg == "--camera") driver_config.camera_input = argv[i + 1];
+	}
+
+	MYAI_SPACE::MyaiController controller(10, driver_config);
+	controller.init(snapshot_path);
+	if (!import_path.empty()) {
+		size_t count = controller.service()->importSnapshot(import_path);
+		std::cout << "imported " << count << " node(s)." << std::endl;
+	}
 	controller.run();
+	controller.destroy();
+	if (!export_path.empty()) {
+		size_t count = controller.service()->exportSnapshot(export_path);
+		std::cout << "exported " << count << " node(s)." << std::endl;
+	}
 	std::cout << "Hello world!" << std::endl;
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,197 @@
+#ifndef MYAI_SIMD_H_
+#define MYAI_SIMD_H_
+
+#include "define.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MYAI_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+MYAI_BEGIN
+
+/**
+ * @brief 权重数组和信号处理的向量化计算核心
+ * @note 未开启SSE2时退化为标量循环
+ */
+namespace simd {
+
+// w[i] *= s
+inline void scale(weight_t *w, size_t n, weight_t s) {
+	size_t i = 0;
+#ifdef MYAI_SIMD_SSE2
+	const __m128 vs = _mm_set1_ps(s);
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(w + i, _mm_mul_ps(_mm_loadu_ps(w + i), vs));
+	}
+#endif
+	for (; i < n; ++i) {
+		w[i] *= s;
+	}
+}
+
+// dst[i] += src[i] * s
+inline void axpy(weight_t *dst, const weight_t *src, size_t n, weight_t s) {
+	size_t i = 0;
+#ifdef MYAI_SIMD_SSE2
+	const __m128 vs = _mm_set1_ps(s);
+	for (; i + 4 <= n; i += 4) {
+		__m128 d = _mm_loadu_ps(dst + i);
+		d		 = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(src + i), vs));
+		_mm_storeu_ps(dst + i, d);
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] += src[i] * s;
+	}
+}
+
+// dst[i] = src[i] * s
+inline void scale_copy(weight_t *dst, const weight_t *src, size_t n, weight_t s) {
+	size_t i = 0;
+#ifdef MYAI_SIMD_SSE2
+	const __m128 vs = _mm_set1_ps(s);
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), vs));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = src[i] * s;
+	}
+}
+
+// dst[i] = a[i] * b[i]
+inline void mul(float *dst, const float *a, const float *b, size_t n) {
+	size_t i = 0;
+#ifdef MYAI_SIMD_SSE2
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = a[i] * b[i];
+	}
+}
+
+// dst[i] = re[i]^2 + im[i]^2
+inline void norm2(float *dst, const float *re, const float *im, size_t n) {
+	size_t i = 0;
+#ifdef MYAI_SIMD_SSE2
+	for (; i + 4 <= n; i += 4) {
+		const __m128 r = _mm_loadu_ps(re + i), m = _mm_loadu_ps(im + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m)));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = re[i] * re[i] + im[i] * im[i];
+	}
+}
+
+// sum(a[i] * b[i])
+inline float dot(const float *a, const float *b, size_t n) {
+	size_t i  = 0;
+	float sum = 0;
+#ifdef MYAI_SIMD_SSE2
+	__m128 acc = _mm_setzero_ps();
+	for (; i + 4 <= n; i += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, acc);
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for (; i < n; ++i) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+/**
+ * @brief FFT蝶形运算（实部虚部分开存放）
+ * @details (x0, x1) <- (x0 + w*x1, x0 - w*x1)，w为旋转因子
+ */
+inline void butterfly(float *re0, float *im0, float *re1, float *im1, const float *wr, const float *wi, size_t n) {
+	size_t i = 0;
+#ifdef MYAI_SIMD_SSE2
+	for (; i + 4 <= n; i += 4) {
+		const __m128 ar = _mm_loadu_ps(re0 + i), ai = _mm_loadu_ps(im0 + i);
+		const __m128 br = _mm_loadu_ps(re1 + i), bi = _mm_loadu_ps(im1 + i);
+		const __m128 cr = _mm_loadu_ps(wr + i), ci = _mm_loadu_ps(wi + i);
+		const __m128 vr = _mm_sub_ps(_mm_mul_ps(br, cr), _mm_mul_ps(bi, ci));
+		const __m128 vi = _mm_add_ps(_mm_mul_ps(br, ci), _mm_mul_ps(bi, cr));
+		_mm_storeu_ps(re0 + i, _mm_add_ps(ar, vr));
+		_mm_storeu_ps(im0 + i, _mm_add_ps(ai, vi));
+		_mm_storeu_ps(re1 + i, _mm_sub_ps(ar, vr));
+		_mm_storeu_ps(im1 + i, _mm_sub_ps(ai, vi));
+	}
+#endif
+	for (; i < n; ++i) {
+		const float vr = re1[i] * wr[i] - im1[i] * wi[i];
+		const float vi = re1[i] * wi[i] + im1[i] * wr[i];
+		re1[i]		   = re0[i] - vr;
+		im1[i]		   = im0[i] - vi;
+		re0[i] += vr;
+		im0[i] += vi;
+	}
+}
+
+// sum(|a[i] - b[i]|)，8位无符号
+inline uint64 sad(const uint8_t *a, const uint8_t *b, size_t n) {
+	size_t i   = 0;
+	uint64 sum = 0;
+#ifdef MYAI_SIMD_SSE2
+	__m128i acc = _mm_setzero_si128();
+	for (; i + 16 <= n; i += 16) {
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		acc				 = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+	}
+	alignas(16) uint64 lanes[2];
+	_mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+	sum = lanes[0] + lanes[1];
+#endif
+	for (; i < n; ++i) {
+		sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+	}
+	return sum;
+}
+
+// sum(a[i])，8位无符号
+inline uint64 sum(const uint8_t *a, size_t n) {
+	size_t i	 = 0;
+	uint64 total = 0;
+#ifdef MYAI_SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc		   = zero;
+	for (; i + 16 <= n; i += 16) {
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), zero));
+	}
+	alignas(16) uint64 lanes[2];
+	_mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+	total = lanes[0] + lanes[1];
+#endif
+	for (; i < n; ++i) {
+		total += a[i];
+	}
+	return total;
+}
+
+// 返回从a、b起始处连续相等的id个数（按4个一组比较）
+inline size_t equal_prefix(const nodeid_t *a, const nodeid_t *b, size_t n) {
+	size_t i = 0;
+#ifdef MYAI_SIMD_SSE2
+	for (; i + 4 <= n; i += 4) {
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(va, vb)) != 0xFFFF) break;
+	}
+#endif
+	while (i < n && a[i] == b[i]) ++i;
+	return i;
+}
+
+}// namespace simd
+
+MYAI_END
+
+#endif// !MYAI_SIMD_H_
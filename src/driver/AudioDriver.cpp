@@ -0,0 +1,317 @@
+#include "AudioDriver.h"
+#include "../core/simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+MYAI_BEGIN
+
+namespace {
+constexpr float PI				 = 3.14159265358979f;
+constexpr float SMOOTH_ALPHA	 = 0.3f; // 频带能量的平滑系数，压低单帧功率谱的波动
+constexpr float FLOOR_FALL		 = 0.1f; // 能量低于噪声底时噪声底的下降比例
+constexpr float FLOOR_RISE_DB	 = 0.01f;// 每帧噪声底的上升量，使其能跟上变大的背景噪声
+constexpr float LEVEL_RANGE_DB	 = 60.0f;// 输入值1对应高出噪声底的分贝数
+constexpr float LEVEL_QUANTUM	 = 32.0f;// 输入值的量化级数，减少微小变化引起的发布
+constexpr float ENERGY_EPSILON	 = 1e-10f;
+
+float hz_to_mel(float hz) { return 2595.0f * std::log10(1.0f + hz / 700.0f); }
+float mel_to_hz(float mel) { return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f); }
+
+template<typename T>
+T read_le(const char *p) {
+	T val;
+	std::memcpy(&val, p, sizeof(T));
+	return val;
+}
+}// namespace
+
+//=================================================================
+// SpectralFrontEnd
+//=================================================================
+
+SpectralFrontEnd::SpectralFrontEnd(size_t frame_size, size_t band_num, float sample_rate)
+	: m_frame_size(frame_size),
+	  m_band_num(band_num),
+	  m_window(frame_size),
+	  m_re(frame_size),
+	  m_im(frame_size),
+	  m_power(frame_size / 2 + 1),
+	  m_twiddle_re(frame_size),
+	  m_twiddle_im(frame_size),
+	  m_bit_reverse(frame_size) {
+	if (frame_size < 4 || (frame_size & (frame_size - 1)) != 0) MYLIB_THROW("avg error: frame size must be a power of 2");
+
+	for (size_t i = 0; i < frame_size; ++i) {
+		m_window[i] = 0.5f - 0.5f * std::cos(2 * PI * i / frame_size);
+	}
+
+	size_t bits = 0;
+	while ((size_t(1) << bits) < frame_size) ++bits;
+	for (size_t i = 0; i < frame_size; ++i) {
+		uint32 r = 0;
+		for (size_t b = 0; b < bits; ++b) {
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		m_bit_reverse[i] = r;
+	}
+	for (size_t half = 1; half < frame_size; half *= 2) {
+		for (size_t j = 0; j < half; ++j) {
+			m_twiddle_re[half + j] = std::cos(-PI * j / half);
+			m_twiddle_im[half + j] = std::sin(-PI * j / half);
+		}
+	}
+
+	// mel 刻度上等距的三角滤波器
+	const size_t bin_num = frame_size / 2 + 1;
+	const float mel_max	 = hz_to_mel(sample_rate / 2);
+	std::vector<float> centers(band_num + 2);
+	for (size_t i = 0; i < centers.size(); ++i) {
+		centers[i] = mel_to_hz(mel_max * i / (band_num + 1)) * frame_size / sample_rate;
+	}
+	for (size_t b = 0; b < band_num; ++b) {
+		const float lo = centers[b], mid = centers[b + 1], hi = centers[b + 2];
+		const auto first = static_cast<uint32>(std::ceil(lo));
+		const auto last	 = static_cast<uint32>(std::min<float>(std::floor(hi), bin_num - 1));
+		MelFilter filter{first, 0, static_cast<uint32>(m_filter_weights.size())};
+		for (uint32 k = first; k <= last; ++k) {
+			const float w = k <= mid ? (k - lo) / std::max(mid - lo, 1e-6f) : (hi - k) / std::max(hi - mid, 1e-6f);
+			m_filter_weights.push_back(std::max(w, 0.0f));
+			++filter.bin_num;
+		}
+		if (filter.bin_num == 0) {
+			// 低频滤波器窄于一个频点时取最近的频点
+			filter.first_bin = static_cast<uint32>(std::min<float>(std::round(mid), bin_num - 1));
+			filter.bin_num	 = 1;
+			m_filter_weights.push_back(1.0f);
+		}
+		m_filters.push_back(filter);
+	}
+}
+
+void SpectralFrontEnd::process(const float *frame, float *bands) {
+	simd::mul(m_im.data(), frame, m_window.data(), m_frame_size);
+	for (size_t i = 0; i < m_frame_size; ++i) {
+		m_re[m_bit_reverse[i]] = m_im[i];
+	}
+	std::fill(m_im.begin(), m_im.end(), 0.0f);
+	fft();
+
+	simd::norm2(m_power.data(), m_re.data(), m_im.data(), m_power.size());
+	for (size_t b = 0; b < m_band_num; ++b) {
+		const MelFilter &filter = m_filters[b];
+		const float energy		= simd::dot(m_power.data() + filter.first_bin, m_filter_weights.data() + filter.weight_offset, filter.bin_num);
+		bands[b]				= 10.0f * std::log10(energy + ENERGY_EPSILON);
+	}
+}
+
+void SpectralFrontEnd::fft() {
+	// 输入已按位反转排列，逐级做蝶形运算
+	for (size_t half = 1; half < m_frame_size; half *= 2) {
+		for (size_t k = 0; k < m_frame_size; k += 2 * half) {
+			simd::butterfly(m_re.data() + k, m_im.data() + k, m_re.data() + k + half, m_im.data() + k + half,
+							m_twiddle_re.data() + half, m_twiddle_im.data() + half, half);
+		}
+	}
+}
+
+//=================================================================
+// SampleRing
+//=================================================================
+
+SampleRing::SampleRing(size_t capacity) {
+	size_t cap = 1;
+	while (cap < capacity) cap *= 2;
+	m_data.resize(cap);
+	m_mask = cap - 1;
+}
+
+size_t SampleRing::push(const float *data, size_t n) {
+	n = std::min(n, free());
+	for (size_t i = 0; i < n; ++i) {
+		m_data[(m_tail + i) & m_mask] = data[i];
+	}
+	m_tail += n;
+	return n;
+}
+
+void SampleRing::peek(float *out, size_t n) const {
+	const size_t pos   = m_head & m_mask;
+	const size_t first = std::min(n, capacity() - pos);
+	std::copy_n(m_data.data() + pos, first, out);
+	std::copy_n(m_data.data(), n - first, out + first);
+}
+
+//=================================================================
+// AudioDriver
+//=================================================================
+
+AudioDriver::AudioDriver(nodeid_t begin, size_t size, String input_path, Options options)
+	: MyaiDriver(Type::DT_AUDIO, begin, size, true),
+	  m_input_path(std::move(input_path)),
+	  m_options(options),
+	  m_ring(std::max(DEF_RING_SIZE, options.frame_size * 2)) {
+	if (size < ID_SIZE) MYLIB_THROW("avg error: audio driver id size is too small");
+	if (options.band_num > HALF_SIZE) MYLIB_THROW("avg error: audio band num is larger than the input range");
+	if (options.hop_size == 0 || options.hop_size > options.frame_size) MYLIB_THROW("avg error: audio hop size is invalid");
+}
+
+void AudioDriver::regeiste_controls() {
+	if (m_input_path == "-") {
+		m_input = &std::cin;
+	} else {
+		m_file.open(m_input_path, std::ios::binary | std::ios::in);
+		if (!m_file.is_open()) MYLIB_THROW("file error: audio input open failed.");
+		m_input = &m_file;
+	}
+	read_header();
+
+	m_front_end = std::make_unique<SpectralFrontEnd>(m_options.frame_size, m_options.band_num, static_cast<float>(m_sample_rate));
+	m_frame.resize(m_options.frame_size);
+	m_bands.resize(m_options.band_num);
+	m_energy.assign(m_options.band_num, 0.0f);
+	m_floor.assign(m_options.band_num, NAN);
+	m_level.assign(m_options.band_num, 0.0f);
+	resize_inputs(m_options.band_num);
+	m_last_read = std::chrono::steady_clock::now();
+}
+
+void AudioDriver::collect_data() {
+	if (m_eof) return;
+
+	size_t n = m_ring.free();
+	if (m_options.realtime) {
+		// 按流逝时间读取，最多读到缓冲满
+		const auto now	   = std::chrono::steady_clock::now();
+		const auto elapsed = std::chrono::duration<double>(now - m_last_read).count();
+		const auto due	   = static_cast<size_t>(elapsed * m_sample_rate);
+		if (due == 0) return;
+		if (due > n) {
+			// 落后超过缓冲容量时丢弃积压，从当前时刻重新计时
+			m_last_read = now;
+		} else {
+			n = due;
+			m_last_read += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+					std::chrono::duration<double>(static_cast<double>(due) / m_sample_rate));
+		}
+	} else {
+		// 离线时上一帧的输入被取走后才读下一帧
+		if (!pending_empty()) return;
+		n = std::min(n, m_options.hop_size);
+	}
+
+	read_samples(n);
+	process_frames();
+}
+
+void AudioDriver::read_header() {
+	m_byte_size = 0;
+	m_bytes.resize(64);
+	m_input->read(m_bytes.data(), 12);
+	m_byte_size = static_cast<size_t>(m_input->gcount());
+
+	if (m_byte_size < 12 || std::memcmp(m_bytes.data(), "RIFF", 4) != 0 || std::memcmp(m_bytes.data() + 8, "WAVE", 4) != 0) {
+		// 原始PCM：已读的字节就是采样
+		m_sample_rate = m_options.raw_sample_rate;
+		m_channels	  = std::max<uint32>(m_options.raw_channels, 1);
+		m_format	  = 1;
+		m_block_align = 2 * m_channels;
+		return;
+	}
+
+	m_byte_size  = 0;
+	bool has_fmt = false;
+	char chunk[8];
+	while (m_input->read(chunk, 8)) {
+		const auto chunk_size = read_le<uint32>(chunk + 4);
+		if (std::memcmp(chunk, "data", 4) == 0) {
+			if (!has_fmt) break;
+			return;
+		}
+		if (std::memcmp(chunk, "fmt ", 4) == 0) {
+			char fmt[16];
+			if (chunk_size < 16 || !m_input->read(fmt, 16)) break;
+			m_format	  = read_le<uint16_t>(fmt);
+			m_channels	  = read_le<uint16_t>(fmt + 2);
+			m_sample_rate = read_le<uint32>(fmt + 4);
+			m_block_align = read_le<uint16_t>(fmt + 12);
+			const auto bits = read_le<uint16_t>(fmt + 14);
+			if (!((m_format == 1 && bits == 16) || (m_format == 3 && bits == 32)) || m_channels == 0 ||
+				m_block_align != m_channels * bits / 8) {
+				MYLIB_THROW("file error: only 16 bit PCM or 32 bit float wav is supported.");
+			}
+			has_fmt = true;
+			m_input->ignore(chunk_size - 16 + (chunk_size & 1));
+			continue;
+		}
+		m_input->ignore(chunk_size + (chunk_size & 1));
+	}
+	MYLIB_THROW("file error: wav header is corrupted.");
+}
+
+void AudioDriver::read_samples(size_t n) {
+	if (n == 0) return;
+	const size_t need = n * m_block_align;
+	if (m_bytes.size() < need) m_bytes.resize(need);
+	if (m_byte_size < need) {
+		m_input->read(m_bytes.data() + m_byte_size, static_cast<std::streamsize>(need - m_byte_size));
+		m_byte_size += static_cast<size_t>(m_input->gcount());
+		if (!*m_input) m_eof = true;
+	}
+
+	// 解码并混为单声道
+	const size_t frames = m_byte_size / m_block_align;
+	m_samples.resize(frames);
+	const float scale = 1.0f / m_channels;
+	for (size_t i = 0; i < frames; ++i) {
+		const char *p = m_bytes.data() + i * m_block_align;
+		float sum	  = 0;
+		for (uint32 c = 0; c < m_channels; ++c) {
+			sum += m_format == 1 ? read_le<int16_t>(p + c * 2) / 32768.0f : read_le<float>(p + c * 4);
+		}
+		m_samples[i] = sum * scale;
+	}
+	m_ring.push(m_samples.data(), frames);
+
+	const size_t used = frames * m_block_align;
+	std::copy(m_bytes.begin() + used, m_bytes.begin() + m_byte_size, m_bytes.begin());
+	m_byte_size -= used;
+}
+
+void AudioDriver::process_frames() {
+	bool processed = false;
+	std::fill(m_level.begin(), m_level.end(), 0.0f);
+
+	while (m_ring.size() >= m_options.frame_size) {
+		m_ring.peek(m_frame.data(), m_frame.size());
+		m_ring.pop(m_options.hop_size);
+		m_front_end->process(m_frame.data(), m_bands.data());
+		++m_frame_count;
+		processed = true;
+
+		for (size_t b = 0; b < m_bands.size(); ++b) {
+			float &energy = m_energy[b];
+			float &floor  = m_floor[b];
+			if (std::isnan(floor)) {
+				energy = floor = m_bands[b];
+				continue;
+			}
+			energy += SMOOTH_ALPHA * (m_bands[b] - energy);
+			if (energy < floor) floor += FLOOR_FALL * (energy - floor);
+			else floor += FLOOR_RISE_DB;
+			m_level[b] = std::max(m_level[b], energy - floor);
+		}
+	}
+	if (!processed) return;
+
+	for (size_t b = 0; b < m_level.size(); ++b) {
+		float value = 0;
+		if (m_level[b] >= m_options.threshold_db) {
+			value = std::round(std::min(m_level[b] / LEVEL_RANGE_DB, 1.0f) * LEVEL_QUANTUM) / LEVEL_QUANTUM;
+		}
+		update(b, value);
+	}
+}
+
+MYAI_END
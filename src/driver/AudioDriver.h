@@ -0,0 +1,150 @@
+#ifndef MYAI_DRIVER_AUDIO_H_
+#define MYAI_DRIVER_AUDIO_H_
+
+#include "Driver.h"
+
+#include <fstream>
+
+MYAI_BEGIN
+
+/**
+ * @brief 音频帧的频谱前端
+ * @details 加窗(Hann) -> 基2 FFT -> 功率谱 -> mel三角滤波器组 -> 对数能量(dB)，
+ *          逐点运算使用 simd 核心；所有缓冲在构造时分配，处理时不分配内存
+ */
+class SpectralFrontEnd {
+public:
+	// frame_size 必须是2的幂
+	SpectralFrontEnd(size_t frame_size, size_t band_num, float sample_rate);
+
+	// frame 为 frame_size 个采样，bands 输出 band_num 个频带的能量(dB)
+	void process(const float *frame, float *bands);
+
+	size_t frame_size() const { return m_frame_size; }
+	size_t band_num() const { return m_band_num; }
+
+private:
+	void fft();
+
+private:
+	struct MelFilter {
+		uint32 first_bin;
+		uint32 bin_num;
+		uint32 weight_offset;// 在 m_filter_weights 中的起始位置
+	};
+
+	size_t m_frame_size;
+	size_t m_band_num;
+	std::vector<float> m_window;
+	std::vector<float> m_re, m_im, m_power;
+	std::vector<float> m_twiddle_re, m_twiddle_im;// 每级 half 个，从下标 half 开始存放
+	std::vector<uint32> m_bit_reverse;
+	std::vector<MelFilter> m_filters;
+	std::vector<float> m_filter_weights;
+};
+
+/**
+ * @brief 定长采样环形缓冲，容量为2的幂
+ */
+class SampleRing {
+public:
+	explicit SampleRing(size_t capacity);
+
+	size_t size() const { return m_tail - m_head; }
+	size_t capacity() const { return m_mask + 1; }
+	size_t free() const { return capacity() - size(); }
+
+	// 写入采样，超出剩余空间的部分被丢弃，返回写入数
+	size_t push(const float *data, size_t n);
+	// 从队头拷贝n个采样（不出队）
+	void peek(float *out, size_t n) const;
+	void pop(size_t n) { m_head += std::min(n, size()); }
+
+private:
+	std::vector<float> m_data;
+	size_t m_mask;
+	size_t m_head = 0;
+	size_t m_tail = 0;
+};
+
+/**
+ * @brief 音频驱动
+ * @details id布局：输入频带 | 输出(保留)。
+ *          采样线程从WAV或原始PCM(s16le)流读取采样，按帧移切帧计算mel频带能量；
+ *          每个频带跟踪噪声底，只有高出噪声底 threshold_db 的频带作为输入，
+ *          值为量化后的相对能量，未变化的频带不发布。
+ *          内存由环形缓冲限定；实时模式下按流逝时间读取采样，不快于实时，
+ *          离线模式下每次采样读取一个帧移。
+ */
+class AudioDriver : public MyaiDriver {
+public:
+	using ptr								= std::shared_ptr<AudioDriver>;
+	constexpr static size_t HALF_SIZE		= 0x800;
+	constexpr static size_t ID_SIZE			= HALF_SIZE * 2;
+	constexpr static size_t DEF_FRAME_SIZE	= 512;
+	constexpr static size_t DEF_HOP_SIZE	= 256;
+	constexpr static size_t DEF_BAND_NUM	= 64;
+	constexpr static size_t DEF_RING_SIZE	= 1 << 14;
+	constexpr static uint32 DEF_SAMPLE_RATE = 16000;
+	constexpr static float DEF_THRESHOLD_DB = 6.0f;
+
+	struct Options {
+		uint32 raw_sample_rate = DEF_SAMPLE_RATE;// 原始PCM流的采样率，WAV以文件头为准
+		uint32 raw_channels	   = 1;
+		bool realtime		   = true;// 为假时尽快读取（离线文件）
+		size_t frame_size	   = DEF_FRAME_SIZE;
+		size_t hop_size		   = DEF_HOP_SIZE;
+		size_t band_num		   = DEF_BAND_NUM;
+		float threshold_db	   = DEF_THRESHOLD_DB;
+	};
+
+	// input_path 为 "-" 时读取标准输入
+	AudioDriver(nodeid_t begin, size_t size, String input_path, Options options);
+	AudioDriver(nodeid_t begin, size_t size, String input_path) : AudioDriver(begin, size, input_path, Options()) {}
+	~AudioDriver() override { stop(); }
+
+	bool eof() const { return m_eof; }
+	uint32 sample_rate() const { return m_sample_rate; }
+	uint64 frame_count() const { return m_frame_count; }
+
+	// 输出频带暂无对应的音频设备，忽略
+	void control(const Edge *, size_t) override {}
+
+private:
+	virtual void collect_data() override;
+	virtual void regeiste_controls() override;
+
+	// 解析WAV头；不是WAV时按原始PCM处理，已读取的字节作为采样保留
+	void read_header();
+	// 读取最多 n 个采样帧写入环形缓冲
+	void read_samples(size_t n);
+	void process_frames();
+
+private:
+	String m_input_path;
+	Options m_options;
+
+	std::ifstream m_file;
+	std::istream *m_input = nullptr;
+	uint32 m_sample_rate  = DEF_SAMPLE_RATE;
+	uint32 m_channels	  = 1;
+	uint32 m_format		  = 1;// 1:16位整数 3:32位浮点
+	uint32 m_block_align  = 2;
+	std::vector<char> m_bytes;// 未凑满一个采样帧的字节
+	size_t m_byte_size = 0;
+	std::vector<float> m_samples;
+	std::atomic<bool> m_eof{false};
+	std::chrono::steady_clock::time_point m_last_read;
+
+	std::unique_ptr<SpectralFrontEnd> m_front_end;
+	SampleRing m_ring;
+	std::vector<float> m_frame;
+	std::vector<float> m_bands;
+	std::vector<float> m_energy;// 各频带平滑后的能量(dB)
+	std::vector<float> m_floor; // 各频带的噪声底(dB)
+	std::vector<float> m_level;// 本次采样中各频带高出噪声底的最大值
+	std::atomic<uint64> m_frame_count{0};
+};
+
+MYAI_END
+#endif// !MYAI_DRIVER_AUDIO_H_
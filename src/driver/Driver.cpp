@@ -3,6 +3,95 @@
 
 MYAI_BEGIN
 
-std::map<nodeid_t, MyaiDriver::ControlConnectionFunc> MyaiDriver::S_CONNECTIONS{};
+void MyaiDriver::start() {
+	if (!m_async || m_running.exchange(true)) return;
+	m_sampler = std::thread(&MyaiDriver::sample_loop, this);
+}
 
-MYAI_END
\ No newline at end of file
+void MyaiDriver::stop() {
+	if (!m_running.exchange(false)) return;
+	{
+		std::lock_guard<std::mutex> lock(m_sampler_mutex);
+	}
+	m_sampler_cv.notify_all();
+	if (m_sampler.joinable()) m_sampler.join();
+}
+
+EdgeList::ptr MyaiDriver::collect() {
+	if (!m_async) {
+		collect_data();
+		publish_dirty(*m_collects);
+		return m_collects;
+	}
+
+	// m_collects 已在上一轮 reset，交换后作为新的后台缓冲
+	std::lock_guard<std::mutex> lock(m_pending_mutex);
+	std::swap(m_collects, m_pending);
+	return m_collects;
+}
+
+void MyaiDriver::sample_loop() {
+	while (m_running.load()) {
+		// 采样在锁外进行，只在写入后台缓冲时短暂加锁
+		collect_data();
+		{
+			std::lock_guard<std::mutex> lock(m_pending_mutex);
+			publish_dirty(*m_pending);
+		}
+
+		std::unique_lock<std::mutex> lock(m_sampler_mutex);
+		m_sampler_cv.wait_for(lock, sample_interval(), [this] { return !m_running.load(); });
+	}
+}
+
+void MyaiDriver::control(const Edge *edges, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		const size_t offset = edges[i].id - m_begin;
+		if (offset < m_controls.size() && m_controls[offset]) {
+			m_controls[offset](offset, edges[i].weight);
+		}
+	}
+}
+
+void MyaiDriver::regeiste_control(size_t offset, ControlHandler handler) {
+	if (offset >= m_id_size) MYLIB_THROW("avg error: control id is out of driver range");
+	if (offset >= m_controls.size()) m_controls.resize(offset + 1);
+	m_controls[offset] = handler;
+}
+
+void MyaiDriver::regeiste_control(size_t offset, weight_t &target) {
+	regeiste_control(offset, ControlHandler{[](void *ctx, size_t, weight_t weight) { *static_cast<weight_t *>(ctx) = weight; }, &target});
+}
+
+void MyaiDriver::regeiste_input_control(size_t offset) {
+	if (offset >= m_inputs.size()) MYLIB_THROW("avg error: control id has no input");
+	regeiste_control(offset, ControlHandler{[](void *ctx, size_t offset, weight_t weight) {
+						 static_cast<MyaiDriver *>(ctx)->update(offset, weight);
+					 },
+											this});
+}
+
+void MyaiDriver::resize_inputs(size_t size, weight_t value) {
+	if (size > m_id_size) MYLIB_THROW("avg error: input size is out of driver range");
+	m_inputs.assign(size, value);
+	m_dirty_flags.assign(size, false);
+	m_dirty.clear();
+	for (size_t i = 0; i < size; ++i) {
+		mark_dirty(i);
+	}
+}
+
+void MyaiDriver::publish_dirty(EdgeList &out) {
+	// 后台缓冲可能还有未取走的旧值，以最新值覆盖而不是累加
+	for (auto offset: m_dirty) {
+		out.emplace(static_cast<nodeid_t>(m_begin + offset), 0).weight = m_inputs[offset];
+		m_dirty_flags[offset] = false;
+	}
+	m_dirty.clear();
+	for (auto &[offset, weight]: m_events) {
+		out.emplace(static_cast<nodeid_t>(m_begin + offset), weight);
+	}
+	m_events.clear();
+}
+
+MYAI_END
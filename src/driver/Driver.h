@@ -3,8 +3,12 @@
 
 #include "../core/Edge.h"
 
-#include <functional>
-#include <map>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 
 MYAI_BEGIN
@@ -15,9 +19,16 @@ MYAI_BEGIN
  */
 class MyaiDriver {
 public:
-	using ptr					= std::shared_ptr<MyaiDriver>;
-	using ControlConnectionFunc = std::function<void(weight_t)>;
-	static std::map<nodeid_t, ControlConnectionFunc> S_CONNECTIONS;
+	using ptr = std::shared_ptr<MyaiDriver>;
+
+	// 控制回调：函数指针+上下文，调用时不分配内存；offset 为 id-m_begin
+	struct ControlHandler {
+		void (*func)(void *ctx, size_t offset, weight_t weight) = nullptr;
+		void *ctx												= nullptr;
+
+		explicit operator bool() const { return func != nullptr; }
+		void operator()(size_t offset, weight_t weight) const { func(ctx, offset, weight); }
+	};
 
 	enum Type {
 		DT_MEMORY,
@@ -31,29 +42,105 @@ public:
 	};
 
 
-	MyaiDriver(Type type, nodeid_t begin, size_t id_size)
-		: m_type(type), m_begin(begin), m_id_size(id_size), m_collects(std::make_shared<EdgeList>()) {
+	constexpr static std::chrono::milliseconds DEF_SAMPLE_INTERVAL{10};
+
+	/**
+	 * @param async 为真时 collect_data 在独立的采样线程中运行，
+	 *              变化写入后台缓冲，collect 只交换缓冲
+	 */
+	MyaiDriver(Type type, nodeid_t begin, size_t id_size, bool async = false)
+		: m_type(type),
+		  m_begin(begin),
+		  m_id_size(id_size),
+		  m_async(async),
+		  m_collects(std::make_shared<EdgeList>()),
+		  m_pending(std::make_shared<EdgeList>()) {
 	}
 
-	virtual ~MyaiDriver() = default;
+	// 派生类析构前必须先 stop，否则采样线程可能调用已析构的 collect_data
+	virtual ~MyaiDriver() { stop(); }
 
 	void init() {
 		regeiste_controls();
 	}
-
-	EdgeList::ptr collect() {
-		collect_data();
-		return m_collects;
-	}
+	// 启动采样线程（仅异步驱动）
+	void start();
+	void stop();
+
+	/**
+	 * @brief 收集本轮的输入
+	 * @details 只包含上次 reset 以来变化的输入：collect_data 通过 update
+	 *          更新输入值，值变化的输入进入脏集合，再写入 m_collects。
+	 *          异步驱动由采样线程写入后台缓冲，这里只交换前后台缓冲，不等待采样
+	 */
+	EdgeList::ptr collect();
+	// 本轮输入已被取走，清空 m_collects
+	void reset() { m_collects->clear(); }
+	bool isAsync() const { return m_async; }
 
 	auto getCollects() { return m_collects; }
 
+	Type type() const { return m_type; }
+	nodeid_t begin() const { return m_begin; }
+	nodeid_t end() const { return static_cast<nodeid_t>(m_begin + m_id_size); }
+	bool contains(nodeid_t id) const { return id >= m_begin && id < end(); }
+
+	/**
+	 * @brief 批量控制
+	 * @details edges 的id都在本驱动范围内，按 id-m_begin 直接索引控制表，
+	 *          未注册的id忽略
+	 */
+	virtual void control(const Edge *edges, size_t n);
+	// 一轮的控制分发完后调用，有缓冲输出的驱动在此一次提交
+	virtual void flushControls() {}
+	// id是本驱动已注册的控制时为真；只作输入的id不是控制，随前沿激活
+	virtual bool isControl(nodeid_t id) const {
+		const size_t offset = id - m_begin;
+		return contains(id) && offset < m_controls.size() && static_cast<bool>(m_controls[offset]);
+	}
+
 protected:
 	using super						 = MyaiDriver;
 
 
 	virtual void collect_data()		 = 0;
 	virtual void regeiste_controls() = 0;
+	// 异步驱动两次采样的间隔
+	virtual std::chrono::milliseconds sample_interval() const { return DEF_SAMPLE_INTERVAL; }
+
+	// 注册 m_begin+offset 的控制回调
+	void regeiste_control(size_t offset, ControlHandler handler);
+	// 控制值直接写入 target
+	void regeiste_control(size_t offset, weight_t &target);
+	// 控制值通过 update 写入同id的输入
+	// @note 异步驱动的输入只能由采样线程修改，不能使用
+	void regeiste_input_control(size_t offset);
+
+	// 设置输入的数量，全部输入初始化为value并标记为脏，使首轮发布完整状态
+	void resize_inputs(size_t size, weight_t value = 0);
+	weight_t input(size_t offset) const { return m_inputs[offset]; }
+	// 更新输入值，与当前值不同时标记为脏
+	void update(size_t offset, weight_t value) {
+		if (m_inputs[offset] == value) return;
+		m_inputs[offset] = value;
+		mark_dirty(offset);
+	}
+	void mark_dirty(size_t offset) {
+		if (m_dirty_flags[offset]) return;
+		m_dirty_flags[offset] = true;
+		m_dirty.push_back(offset);
+	}
+	// 发出一次事件输入，与本轮同id的事件累加，不改变输入值
+	void emit(size_t offset, weight_t weight) { m_events.emplace_back(offset, weight); }
+	// 上次发布的输入是否已被 collect 取走（用于异步驱动控制读取速度）
+	bool pending_empty() {
+		std::lock_guard<std::mutex> lock(m_pending_mutex);
+		return m_pending->empty();
+	}
+
+private:
+	void publish_dirty(EdgeList &out);
+	void sample_loop();
 
 
 protected:
@@ -61,41 +148,25 @@ protected:
 	nodeid_t m_begin;
 	size_t m_id_size;
 
+	bool m_async;
 	EdgeList::ptr m_collects;
+	std::vector<ControlHandler> m_controls;// 按 id-m_begin 索引
+
+	std::vector<weight_t> m_inputs;// 按 id-m_begin 索引的当前输入值
+	std::vector<bool> m_dirty_flags;
+	std::vector<size_t> m_dirty;// 自上次发布以来变化的输入
+	std::vector<std::pair<size_t, weight_t>> m_events;
+
+	// 异步采样：采样线程写 m_pending，collect 时与 m_collects 交换
+	EdgeList::ptr m_pending;
+	std::mutex m_pending_mutex;
+	std::thread m_sampler;
+	std::atomic<bool> m_running{false};
+	std::mutex m_sampler_mutex;
+	std::condition_variable m_sampler_cv;
 };
 
 
-MYAI_END
-
-
-MYAI_BEGIN
-
-//size = 1 0000H+1 0000H
-class StringDriver : public MyaiDriver {
-};
-
-MYAI_END
-
-MYAI_BEGIN
-
-//size = 800H+800H
-class AudioDriver : public MyaiDriver {
-public:
-private:
-};
-
-MYAI_END
-
-MYAI_BEGIN
-
-//size = 40 0000H+4H
-class ScreenVideoDriver : public MyaiDriver {
-};
-
-//size = 40 0000H+8H
-class CameraVideoDriver : public MyaiDriver {
-};
-
 MYAI_END
 
 #endif// !MYAI_DRIVER_H_
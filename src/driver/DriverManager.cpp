@@ -1,21 +1,57 @@
 #include "DriverManager.h"
 
+#include <algorithm>
+
 MYAI_BEGIN
 
 MyaiDriver::ptr DriverManager::addDriver(MyaiDriver::ptr driver) {
 	m_drivers.push_back(driver);
+	auto pos = std::upper_bound(m_control_table.begin(), m_control_table.end(), driver->begin(),
+								[](nodeid_t id, const MyaiDriver *var) { return id < var->begin(); });
+	m_control_table.insert(pos, driver.get());
 	return driver;
 }
 
 void DriverManager::collect(EdgeList::ptr out) {
 	for (auto &var: m_drivers) {
-		auto temp = var->collect();
-		out->insert(temp->begin(), temp->end());
+		out->insert(*var->collect());
+		// 已取走的输入不再带入下一轮
+		var->reset();
 	}
 }
 
 void DriverManager::control(const Edge &output) {
-	MyaiDriver::S_CONNECTIONS.at(output.id)(output.weight);
+	if (auto *driver = find_driver(output.id)) {
+		driver->control(&output, 1);
+		driver->flushControls();
+	}
+}
+
+void DriverManager::control(std::vector<Edge> &outputs) {
+	// 驱动的范围互不重叠，按起始id稳定排序即按驱动分组，组内的先后不变
+	auto driver_begin = [this](const Edge &edge) {
+		const MyaiDriver *driver = find_driver(edge.id);
+		return driver == nullptr ? nodeid_t(0) : driver->begin();
+	};
+	std::stable_sort(outputs.begin(), outputs.end(), [&](const Edge &a, const Edge &b) { return driver_begin(a) < driver_begin(b); });
+	for (size_t i = 0, j = 0; i < outputs.size(); i = j) {
+		auto *driver = find_driver(outputs[i].id);
+		j			 = i + 1;
+		if (driver == nullptr) continue;
+		while (j < outputs.size() && driver->contains(outputs[j].id)) ++j;
+		driver->control(outputs.data() + i, j - i);
+	}
+	for (auto *driver: m_control_table) {
+		driver->flushControls();
+	}
+}
+
+MyaiDriver *DriverManager::find_driver(nodeid_t id) const {
+	auto pos = std::upper_bound(m_control_table.begin(), m_control_table.end(), id,
+								[](nodeid_t id, const MyaiDriver *var) { return id < var->begin(); });
+	if (pos == m_control_table.begin()) return nullptr;
+	--pos;
+	return (*pos)->contains(id) ? *pos : nullptr;
 }
 
 MYAI_END
\ No newline at end of file
@@ -2,9 +2,12 @@
 #define MYLIB_DRIVER_MANAGER_H_
 
 
+#include "AudioDriver.h"
 #include "Driver.h"
 #include "MemoryDriver.h"
 #include "StatusDriver.h"
+#include "StringDriver.h"
+#include "VideoDriver.h"
 
 
 #include "../core/MyaiService.h"
@@ -12,6 +15,11 @@
 
 MYAI_BEGIN
 struct DriverConfig {
+	String text_input;		// 文本驱动的输入，"-" 为标准输入，为空时不启用
+	String text_vocabulary;// 文本驱动的词表文件
+	String audio_input;	   // 音频驱动的输入(WAV或16kHz s16le)，"-" 为标准输入，为空时不启用
+	String screen_input;   // 屏幕视频驱动的输入(y4m)，为空时不启用
+	String camera_input;   // 摄像头视频驱动的输入(y4m)，为空时不启用
 };
 
 
@@ -19,45 +27,104 @@ class DriverManager {
 public:
 	using ptr = std::shared_ptr<DriverManager>;
 	// using Motive = void(const Edge &);
-	static constexpr nodeid_t MAX_CONTROL_NODE_ID = 0x1000'0000;
 
-	DriverManager(MyaiService::ptr ser) : m_service(ser) {}
+	// 各驱动的id块按固定顺序申请，未启用的驱动也占位，启用驱动不会移动其他id
+	static constexpr size_t STATUS_ID_SIZE		 = 1000;
+	static constexpr size_t MEMORY_ID_SIZE		 = 100;
+	static constexpr size_t STRING_ID_SIZE		 = StringDriver::ID_SIZE;
+	static constexpr size_t AUDIO_ID_SIZE		 = AudioDriver::ID_SIZE;
+	static constexpr size_t SCREEN_VIDEO_ID_SIZE = ScreenVideoDriver::ID_SIZE;
+	static constexpr size_t CAMERA_VIDEO_ID_SIZE = CameraVideoDriver::ID_SIZE;
+	static constexpr size_t RESERVED_ID_SIZE	 = STATUS_ID_SIZE + MEMORY_ID_SIZE + STRING_ID_SIZE + AUDIO_ID_SIZE +
+											   SCREEN_VIDEO_ID_SIZE + CAMERA_VIDEO_ID_SIZE;
 
-	void init() {
+	DriverManager(MyaiService::ptr ser, DriverConfig config = DriverConfig()) : m_service(ser), m_config(config) {}
+	~DriverManager() { stop(); }
 
-		m_status = std::make_shared<StatusDriver>(m_service->applyId(1000), 1000);
-		m_memory = std::make_shared<MemoryDriver>(m_service->applyId(100), 100);
-		m_drivers.push_back(m_status);
-		m_drivers.push_back(m_memory);
+	void init() {
+		const nodeid_t status_begin = m_service->applyId(STATUS_ID_SIZE);
+		const nodeid_t memory_begin = m_service->applyId(MEMORY_ID_SIZE);
+		const nodeid_t string_begin = m_service->applyId(STRING_ID_SIZE);
+		const nodeid_t audio_begin	= m_service->applyId(AUDIO_ID_SIZE);
+		const nodeid_t screen_begin = m_service->applyId(SCREEN_VIDEO_ID_SIZE);
+		const nodeid_t camera_begin = m_service->applyId(CAMERA_VIDEO_ID_SIZE);
+
+		m_status = std::make_shared<StatusDriver>(status_begin, STATUS_ID_SIZE);
+		m_memory = std::make_shared<MemoryDriver>(memory_begin, MEMORY_ID_SIZE);
+		addDriver(m_status);
+		addDriver(m_memory);
+		if (!m_config.text_input.empty()) {
+			addDriver(std::make_shared<StringDriver>(string_begin, STRING_ID_SIZE, m_config.text_input, m_config.text_vocabulary));
+		}
+		if (!m_config.audio_input.empty()) {
+			addDriver(std::make_shared<AudioDriver>(audio_begin, AUDIO_ID_SIZE, m_config.audio_input));
+		}
+		if (!m_config.screen_input.empty()) {
+			addDriver(std::make_shared<ScreenVideoDriver>(screen_begin, SCREEN_VIDEO_ID_SIZE, m_config.screen_input));
+		}
+		if (!m_config.camera_input.empty()) {
+			addDriver(std::make_shared<CameraVideoDriver>(camera_begin, CAMERA_VIDEO_ID_SIZE, m_config.camera_input));
+		}
 
 		for (auto &driver: m_drivers) {
 			driver->init();
 		}
+		// 异步驱动开始采样，与推理并行
+		for (auto &driver: m_drivers) {
+			driver->start();
+		}
+	}
+	// 停止所有异步驱动的采样线程
+	void stop() {
+		for (auto &driver: m_drivers) {
+			driver->stop();
+		}
 	}
 	MyaiDriver::ptr addDriver(MyaiDriver::ptr driver);
 
+	/// @brief 合并各驱动本轮的输入，异步驱动只交换缓冲，不等待采样
 	void collect(EdgeList::ptr out);
 
+	/// @brief id是某个驱动的控制时为对外输出，其余（含驱动的输入）留在前沿中激活
+	bool isControl(nodeid_t id) const {
+		const MyaiDriver *driver = find_driver(id);
+		return driver != nullptr && driver->isControl(id);
+	}
+
 	/// @brief 控制
 	/// @param output 对外输出数据
 	void control(const Edge &output);
+	/// @brief 批量控制：按驱动分组，组内保持原顺序，每个驱动的输出一次交给该驱动，之后各驱动提交一次输出
+	/// @param outputs 本轮按激活顺序排列的对外输出数据，会按驱动重新分组
+	void control(std::vector<Edge> &outputs);
 
 	// 返回m_positive的值
-	auto positive() const { return m_status->m_positive; }
-	auto negative() const { return m_status->m_negative; }
-	auto filter() const { return m_status->m_filter; }
+	auto positive() const { return m_status->positive(); }
+	auto negative() const { return m_status->negative(); }
+	auto filter() const { return m_status->filter(); }
 	auto driver_weight(MyaiDriver::Type source, MyaiDriver::Type target) const {
-		return m_status->m_driver_weight[source][target];
+		return m_status->driver_weight(source, target);
 	}
 	void activate_node(const Edge &edge) {
 		m_service->activatedNode(m_memory->getCollects(), edge);
 	}
+	void activate_nodes(const std::vector<Edge> &edges) {
+		m_service->activatedNodes(m_memory->getCollects(), edges);
+		// 激活结果是下一轮的前沿，提前读入
+		m_service->prefetch(*m_memory->getCollects());
+	}
+
+private:
+	// 按id范围查找驱动，不属于任何驱动时返回nullptr
+	MyaiDriver *find_driver(nodeid_t id) const;
 
 private:
 	MyaiService::ptr m_service;
+	DriverConfig m_config;
 	StatusDriver::ptr m_status;
 	MemoryDriver::ptr m_memory;
 	std::vector<MyaiDriver::ptr> m_drivers;
+	std::vector<MyaiDriver *> m_control_table;// 按起始id排序
 };
 
 MYAI_END
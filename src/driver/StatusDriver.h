@@ -14,15 +14,24 @@ public:
 	// 构造函数，初始化StatusDriver对象
 	StatusDriver(nodeid_t begin, size_t size) : MyaiDriver(Type::DT_STATUS, begin, size) {}
 
+	weight_t positive() const { return input(POSITIVE_OFFSET); }// 正向权重
+	weight_t negative() const { return input(NEGATIVE_OFFSET); }// 反向权重
+	weight_t filter() const { return input(FILTER_OFFSET); }	// 过滤权重
+	weight_t driver_weight(size_t source, size_t target) const { return input(weight_offset(source, target)); }
+
 private:
-	virtual void collect_data() override;
+	// 输入和控制共用id布局：驱动权重矩阵 | 正向 | 反向 | 过滤
+	constexpr static size_t POSITIVE_OFFSET = __DT_END__ * __DT_END__;
+	constexpr static size_t NEGATIVE_OFFSET = POSITIVE_OFFSET + 1;
+	constexpr static size_t FILTER_OFFSET	= POSITIVE_OFFSET + 2;
+	constexpr static size_t INPUT_SIZE		= FILTER_OFFSET + 1;
+	constexpr static size_t weight_offset(size_t source, size_t target) { return source * __DT_END__ + target; }
+
+	// 状态只由控制修改，变化已在 update 中记入脏集合
+	virtual void collect_data() override {}
 	virtual void regeiste_controls() override;
 
 	size_t m_normal_size = 3;
-	weight_t m_positive;//正向权重
-	weight_t m_negative;// 反向权重
-	weight_t m_filter;	// 过滤权重
-	std::vector<std::vector<weight_t>> m_driver_weight;
 };
 
 MYAI_END
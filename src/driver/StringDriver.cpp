@@ -0,0 +1,199 @@
+#include "StringDriver.h"
+
+#include <algorithm>
+#include <map>
+
+MYAI_BEGIN
+
+namespace {
+// 以 lead 开头的UTF-8码点的字节数，续字节和非法字节按1字节处理
+size_t utf8_length(uint8_t lead) {
+	if (lead < 0xC0) return 1;
+	if (lead < 0xE0) return 2;
+	if (lead < 0xF0) return 3;
+	if (lead < 0xF8) return 4;
+	return 1;
+}
+
+// 是否由完整的UTF-8码点组成（不检查超长编码）
+bool is_utf8(const String &text) {
+	for (size_t i = 0; i < text.size();) {
+		const auto lead = static_cast<uint8_t>(text[i]);
+		if ((lead & 0xC0) == 0x80 || lead >= 0xF8) return false;
+		const size_t length = utf8_length(lead);
+		if (i + length > text.size()) return false;
+		for (size_t k = 1; k < length; ++k) {
+			if ((static_cast<uint8_t>(text[i + k]) & 0xC0) != 0x80) return false;
+		}
+		i += length;
+	}
+	return true;
+}
+}// namespace
+
+//=================================================================
+// TokenTable
+//=================================================================
+
+void TokenTable::build(const std::vector<String> &tokens) {
+	// 构建期使用有序map的临时trie，之后压平
+	struct BuildNode {
+		std::map<uint8_t, uint32> children;
+		uint32 token = NULL_TOKEN;
+	};
+	std::vector<BuildNode> build_nodes(1);
+	m_text.clear();
+	m_text_offsets.assign(1, 0);
+	m_max_length = 1;
+
+	auto add_token = [&](const char *data, size_t size) {
+		uint32 node = 0;
+		for (size_t i = 0; i < size; ++i) {
+			const auto byte = static_cast<uint8_t>(data[i]);
+			auto fd_rt		= build_nodes[node].children.find(byte);
+			if (fd_rt == build_nodes[node].children.end()) {
+				fd_rt = build_nodes[node].children.emplace(byte, static_cast<uint32>(build_nodes.size())).first;
+				build_nodes.emplace_back();
+			}
+			node = fd_rt->second;
+		}
+		if (build_nodes[node].token != NULL_TOKEN) return;
+		build_nodes[node].token = static_cast<uint32>(size_t(m_text_offsets.size()) - 1);
+		m_text.insert(m_text.end(), data, data + size);
+		m_text_offsets.push_back(static_cast<uint32>(m_text.size()));
+		m_max_length = std::max(m_max_length, size);
+	};
+
+	for (int byte = 0; byte < 256; ++byte) {
+		const char c = static_cast<char>(byte);
+		add_token(&c, 1);
+	}
+	// 多字节词元必须是完整的码点序列，匹配时只在码点边界结束
+	for (auto &token: tokens) {
+		if (!token.empty() && is_utf8(token)) add_token(token.data(), token.size());
+	}
+
+	// 按广度优先压平，子边按字节有序
+	m_nodes.assign(build_nodes.size(), TrieNode{});
+	m_edge_bytes.clear();
+	m_edge_targets.clear();
+	for (size_t i = 0; i < build_nodes.size(); ++i) {
+		m_nodes[i].token	  = build_nodes[i].token;
+		m_nodes[i].first_edge = static_cast<uint32>(m_edge_bytes.size());
+		m_nodes[i].edge_num	  = static_cast<uint32>(build_nodes[i].children.size());
+		for (auto &[byte, child]: build_nodes[i].children) {
+			m_edge_bytes.push_back(byte);
+			m_edge_targets.push_back(child);
+		}
+	}
+	for (int byte = 0; byte < 256; ++byte) {
+		m_root[byte] = build_nodes[0].children.at(static_cast<uint8_t>(byte));
+	}
+}
+
+size_t TokenTable::match(const char *data, size_t size, uint32 &token) const {
+	if (size == 0) return 0;
+
+	// 单字节词元兜底；更长的词元只在码点结束处接受
+	uint32 node		= m_root[static_cast<uint8_t>(data[0])];
+	size_t length	= 1;
+	size_t boundary = utf8_length(static_cast<uint8_t>(data[0]));// 当前码点结束的位置
+	token			= m_nodes[node].token;
+	for (size_t i = 1; i < size; ++i) {
+		const TrieNode &cur = m_nodes[node];
+		if (cur.edge_num == 0) break;
+
+		const auto byte	 = static_cast<uint8_t>(data[i]);
+		const auto *beg	 = m_edge_bytes.data() + cur.first_edge;
+		const auto *end	 = beg + cur.edge_num;
+		const auto *edge = std::lower_bound(beg, end, byte);
+		if (edge == end || *edge != byte) break;
+
+		node = m_edge_targets[edge - m_edge_bytes.data()];
+		if (i + 1 < boundary) continue;
+		if (i + 1 < size) boundary = i + 1 + utf8_length(static_cast<uint8_t>(data[i + 1]));
+		if (m_nodes[node].token != NULL_TOKEN) {
+			token  = m_nodes[node].token;
+			length = i + 1;
+		}
+	}
+	return length;
+}
+
+//=================================================================
+// StringDriver
+//=================================================================
+
+StringDriver::StringDriver(nodeid_t begin, size_t size, String input_path, String vocabulary_path,
+						   std::ostream &output, size_t chunk_size)
+	: MyaiDriver(Type::DT_STRING, begin, size, true),
+	  m_input_path(std::move(input_path)),
+	  m_vocabulary_path(std::move(vocabulary_path)),
+	  m_output(output),
+	  m_chunk_size(std::max<size_t>(chunk_size, 1)) {
+	if (size < ID_SIZE) MYLIB_THROW("avg error: string driver id size is too small");
+}
+
+void StringDriver::regeiste_controls() {
+	std::vector<String> vocabulary;
+	if (!m_vocabulary_path.empty()) {
+		std::ifstream file(m_vocabulary_path);
+		if (!file.is_open()) MYLIB_THROW("file error: vocabulary open failed.");
+		for (String line; std::getline(file, line);) {
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			vocabulary.push_back(line);
+		}
+	}
+	m_tokens.build(vocabulary);
+	if (m_tokens.size() > HALF_SIZE) MYLIB_THROW("avg error: vocabulary is larger than the string driver id range");
+
+	if (m_input_path == "-") {
+		m_input = &std::cin;
+	} else {
+		m_file.open(m_input_path, std::ios::binary | std::ios::in);
+		if (!m_file.is_open()) MYLIB_THROW("file error: text input open failed.");
+		m_input = &m_file;
+	}
+	m_buffer.resize(m_chunk_size + m_tokens.max_length());
+	m_buffer_size = 0;
+	m_eof		  = false;
+}
+
+void StringDriver::collect_data() {
+	// 上一块还没被推理取走时不读取，每轮最多一块
+	if (m_eof || !pending_empty()) return;
+
+	m_input->read(m_buffer.data() + m_buffer_size, static_cast<std::streamsize>(m_chunk_size));
+	m_buffer_size += static_cast<size_t>(m_input->gcount());
+	m_eof = !*m_input;
+	tokenize(m_eof);
+}
+
+void StringDriver::tokenize(bool last) {
+	const char *data = m_buffer.data();
+	size_t pos		 = 0;
+	uint32 token	 = TokenTable::NULL_TOKEN;
+	// 剩余字节不足最长词元时可能被下一块延长，留到下一块
+	while (pos < m_buffer_size && (last || m_buffer_size - pos >= m_tokens.max_length())) {
+		pos += m_tokens.match(data + pos, m_buffer_size - pos, token);
+		emit(token, 1.0f);
+	}
+	std::copy(m_buffer.begin() + pos, m_buffer.begin() + m_buffer_size, m_buffer.begin());
+	m_buffer_size -= pos;
+}
+
+void StringDriver::control(const Edge *edges, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		const size_t offset = edges[i].id - m_begin;
+		if (offset < HALF_SIZE) continue;
+		const auto token = static_cast<uint32>(offset - HALF_SIZE);
+		if (token >= m_tokens.size()) continue;
+		m_output.write(m_tokens.text(token), static_cast<std::streamsize>(m_tokens.length(token)));
+	}
+}
+
+void StringDriver::flushControls() {
+	m_output.flush();
+}
+
+MYAI_END
@@ -0,0 +1,109 @@
+#ifndef MYAI_DRIVER_STRING_H_
+#define MYAI_DRIVER_STRING_H_
+
+#include "Driver.h"
+
+#include <array>
+#include <fstream>
+#include <iostream>
+
+MYAI_BEGIN
+
+/**
+ * @brief 词元表
+ * @details 构建一次后只读：词元编译为扁平的字节trie，根节点按字节直接索引，
+ *          其余节点的子边按字节有序存放；词元文本连续存放。
+ *          0~255 号词元固定为单字节，保证任意输入都能切分；
+ *          其余词元是完整的UTF-8码点序列，匹配只在码点边界结束，不会切开多字节字符。
+ */
+class TokenTable {
+public:
+	constexpr static uint32 NULL_TOKEN = UINT32_MAX;
+
+	// tokens 中重复、空、与单字节相同或不是完整UTF-8的词元被忽略
+	void build(const std::vector<String> &tokens);
+
+	/**
+	 * @brief 在 data 开头按码点做最长匹配，没有多字节词元时退回单字节
+	 * @return 匹配的字节数，size为0时返回0
+	 */
+	size_t match(const char *data, size_t size, uint32 &token) const;
+
+	const char *text(uint32 token) const { return m_text.data() + m_text_offsets[token]; }
+	size_t length(uint32 token) const { return m_text_offsets[token + 1] - m_text_offsets[token]; }
+
+	size_t size() const { return m_text_offsets.empty() ? 0 : m_text_offsets.size() - 1; }
+	size_t max_length() const { return m_max_length; }
+
+private:
+	struct TrieNode {
+		uint32 first_edge = 0;// 子边在 m_edge_bytes 中的起始位置
+		uint32 edge_num	  = 0;
+		uint32 token	  = NULL_TOKEN;
+	};
+
+	std::array<uint32, 256> m_root{};// 单字节对应的节点
+	std::vector<TrieNode> m_nodes;
+	std::vector<uint8_t> m_edge_bytes;
+	std::vector<uint32> m_edge_targets;
+
+	std::vector<char> m_text;
+	std::vector<uint32> m_text_offsets;
+	size_t m_max_length = 1;
+};
+
+/**
+ * @brief 文本驱动
+ * @details id布局：输入词元 | 输出词元，两半使用同一词表。
+ *          采样线程每轮读取一块UTF-8文本，按最长匹配切分，
+ *          每个词元发出一次输入事件；上一块的输入被取走后才读下一块。
+ *          输出词元的控制按分发的顺序（激活顺序）把词元文本写到输出流，每轮刷新一次。
+ */
+class StringDriver : public MyaiDriver {
+public:
+	using ptr							 = std::shared_ptr<StringDriver>;
+	constexpr static size_t HALF_SIZE	 = 0x10000;
+	constexpr static size_t ID_SIZE		 = HALF_SIZE * 2;
+	constexpr static size_t DEF_CHUNK_SIZE = 64ULL << 10;
+
+	/**
+	 * @param input_path 输入文件，"-" 表示标准输入
+	 * @param vocabulary_path 词表文件，每行一个词元；为空时只使用单字节词元
+	 */
+	StringDriver(nodeid_t begin, size_t size, String input_path, String vocabulary_path = String(),
+				 std::ostream &output = std::cout, size_t chunk_size = DEF_CHUNK_SIZE);
+	~StringDriver() override { stop(); }
+
+	const TokenTable &tokens() const { return m_tokens; }
+	bool eof() const { return m_eof; }
+
+	void control(const Edge *edges, size_t n) override;
+	void flushControls() override;
+	// 输出词元的id是控制，输入词元随前沿激活
+	bool isControl(nodeid_t id) const override {
+		return contains(id) && id - m_begin >= HALF_SIZE && id - m_begin - HALF_SIZE < m_tokens.size();
+	}
+
+private:
+	virtual void collect_data() override;
+	virtual void regeiste_controls() override;
+
+	// 切分 m_buffer 中的文本，末尾可能是更长词元前缀的部分留到下一块
+	void tokenize(bool last);
+
+private:
+	String m_input_path;
+	String m_vocabulary_path;
+	std::ostream &m_output;
+	size_t m_chunk_size;
+
+	TokenTable m_tokens;
+	std::ifstream m_file;
+	std::istream *m_input = nullptr;
+	std::vector<char> m_buffer;
+	size_t m_buffer_size = 0;
+	std::atomic<bool> m_eof{false};
+};
+
+MYAI_END
+#endif// !MYAI_DRIVER_STRING_H_
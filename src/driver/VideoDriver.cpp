@@ -0,0 +1,190 @@
+#include "VideoDriver.h"
+#include "../core/simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+MYAI_BEGIN
+
+namespace {
+constexpr double MAX_LAG_SECONDS = 1.0;// 实时模式落后超过该时长时丢弃积压，重新计时
+}// namespace
+
+VideoDriver::VideoDriver(Type type, nodeid_t begin, size_t size, String input_path, Options options)
+	: MyaiDriver(type, begin, size, true),
+	  m_input_path(std::move(input_path)),
+	  m_options(options) {
+	if (size < TILE_ID_SIZE) MYLIB_THROW("avg error: video driver id size is too small");
+	if (options.tile_size == 0) MYLIB_THROW("avg error: video tile size is invalid");
+}
+
+void VideoDriver::regeiste_controls() {
+	if (m_input_path == "-") {
+		m_input = &std::cin;
+	} else {
+		m_file.open(m_input_path, std::ios::binary | std::ios::in);
+		if (!m_file.is_open()) MYLIB_THROW("file error: video input open failed.");
+		m_input = &m_file;
+	}
+	read_header();
+
+	const uint32 tile = m_options.tile_size;
+	m_tiles_x		  = (m_width + tile - 1) / tile;
+	m_tiles_y		  = (m_height + tile - 1) / tile;
+	if (tile_num() > TILE_ID_SIZE) MYLIB_THROW("avg error: video has more tiles than the input range");
+
+	m_luma.assign(size_t(m_width) * m_height, 0);
+	m_reference.assign(m_luma.size(), 0);
+	resize_inputs(tile_num());
+	m_last_read = std::chrono::steady_clock::now();
+}
+
+void VideoDriver::read_header() {
+	char magic[10] = {};
+	m_input->read(magic, 10);
+	m_y4m = m_input->gcount() == 10 && std::memcmp(magic, "YUV4MPEG2 ", 10) == 0;
+
+	if (!m_y4m) {
+		// 原始帧流：已读的字节属于第一帧
+		if (m_options.raw_width == 0 || m_options.raw_height == 0) MYLIB_THROW("avg error: raw video needs width and height");
+		if (m_options.raw_channels != 1 && m_options.raw_channels != 3) MYLIB_THROW("avg error: raw video must be RGB24 or GRAY8");
+		m_width	 = m_options.raw_width;
+		m_height = m_options.raw_height;
+		m_fps	 = m_options.raw_fps > 0 ? m_options.raw_fps : DEF_FPS;
+		m_raw.resize(size_t(m_width) * m_height * m_options.raw_channels);
+		std::memcpy(m_raw.data(), magic, static_cast<size_t>(m_input->gcount()));
+		m_raw_size = static_cast<size_t>(m_input->gcount());
+		return;
+	}
+
+	String line;
+	if (!std::getline(*m_input, line)) MYLIB_THROW("file error: y4m header is corrupted.");
+	String chroma = "420";
+	std::istringstream params(line);
+	for (String param; params >> param;) {
+		const String value = param.substr(1);
+		switch (param[0]) {
+		case 'W': m_width = static_cast<uint32>(std::stoul(value)); break;
+		case 'H': m_height = static_cast<uint32>(std::stoul(value)); break;
+		case 'C': chroma = value; break;
+		case 'F': {
+			const auto colon = value.find(':');
+			const double num = std::stod(value.substr(0, colon));
+			const double den = colon == String::npos ? 1.0 : std::stod(value.substr(colon + 1));
+			if (num > 0 && den > 0) m_fps = num / den;
+			break;
+		}
+		default: break;
+		}
+	}
+	if (m_width == 0 || m_height == 0) MYLIB_THROW("file error: y4m header has no frame size.");
+
+	const size_t cw = (m_width + 1) / 2, ch = (m_height + 1) / 2;
+	// 只接受8位的色度标记，带位深后缀的（如 420p10、mono16）和 444alpha 都拒绝
+	if (chroma == "420" || chroma == "420jpeg" || chroma == "420paldv" || chroma == "420mpeg2") m_chroma_size = 2 * cw * ch;
+	else if (chroma == "422") m_chroma_size = 2 * cw * m_height;
+	else if (chroma == "444") m_chroma_size = 2 * size_t(m_width) * m_height;
+	else if (chroma == "mono") m_chroma_size = 0;
+	else MYLIB_THROW("file error: only 8 bit y4m is supported.");
+}
+
+bool VideoDriver::read_frame(bool discard) {
+	if (m_y4m) {
+		String line;
+		if (!std::getline(*m_input, line)) return false;
+		if (line.compare(0, 5, "FRAME") != 0) MYLIB_THROW("file error: y4m frame header is corrupted.");
+		if (discard) {
+			m_input->ignore(static_cast<std::streamsize>(m_luma.size() + m_chroma_size));
+			return m_input->gcount() == static_cast<std::streamsize>(m_luma.size() + m_chroma_size);
+		}
+		m_input->read(reinterpret_cast<char *>(m_luma.data()), static_cast<std::streamsize>(m_luma.size()));
+		m_input->ignore(static_cast<std::streamsize>(m_chroma_size));
+		return m_input->gcount() == static_cast<std::streamsize>(m_chroma_size) && *m_input;
+	}
+
+	m_input->read(reinterpret_cast<char *>(m_raw.data()) + m_raw_size, static_cast<std::streamsize>(m_raw.size() - m_raw_size));
+	m_raw_size += static_cast<size_t>(m_input->gcount());
+	if (m_raw_size < m_raw.size()) return false;
+	m_raw_size = 0;
+	if (discard) return true;
+
+	if (m_options.raw_channels == 1) {
+		std::memcpy(m_luma.data(), m_raw.data(), m_luma.size());
+		return true;
+	}
+	// BT.601 亮度
+	const uint8_t *rgb = m_raw.data();
+	for (size_t i = 0; i < m_luma.size(); ++i, rgb += 3) {
+		m_luma[i] = static_cast<uint8_t>((77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8);
+	}
+	return true;
+}
+
+void VideoDriver::collect_data() {
+	if (m_eof) return;
+
+	size_t frames = 1;
+	if (m_options.realtime) {
+		const auto now	   = std::chrono::steady_clock::now();
+		const auto elapsed = std::chrono::duration<double>(now - m_last_read).count();
+		frames			   = static_cast<size_t>(elapsed * m_fps);
+		if (frames == 0) return;
+		if (elapsed > MAX_LAG_SECONDS) {
+			m_last_read = now;
+		} else {
+			m_last_read += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+					std::chrono::duration<double>(static_cast<double>(frames) / m_fps));
+		}
+	} else if (!pending_empty()) {
+		// 离线时上一帧的输入被取走后才读下一帧
+		return;
+	}
+
+	// 落后时跳过中间帧，只比较最新一帧
+	for (size_t i = 1; i < frames; ++i) {
+		if (!read_frame(true)) {
+			m_eof = true;
+			return;
+		}
+	}
+	if (!read_frame(false)) {
+		m_eof = true;
+		return;
+	}
+	diff_tiles();
+	++m_frame_count;
+}
+
+void VideoDriver::diff_tiles() {
+	const size_t tile  = m_options.tile_size;
+	const bool first   = m_frame_count == 0;
+	const uint8_t *cur = m_luma.data();
+	uint8_t *ref	   = m_reference.data();
+
+	for (size_t ty = 0; ty < m_tiles_y; ++ty) {
+		const size_t y0 = ty * tile, y1 = std::min<size_t>(y0 + tile, m_height);
+		for (size_t tx = 0; tx < m_tiles_x; ++tx) {
+			const size_t x0 = tx * tile, w = std::min<size_t>(tile, m_width - x0);
+			const size_t pixels = (y1 - y0) * w;
+
+			uint64 diff = 0;
+			for (size_t y = y0; y < y1; ++y) {
+				diff += simd::sad(cur + y * m_width + x0, ref + y * m_width + x0, w);
+			}
+			if (!first && static_cast<float>(diff) < m_options.threshold * pixels) continue;
+
+			uint64 sum = 0;
+			for (size_t y = y0; y < y1; ++y) {
+				std::memcpy(ref + y * m_width + x0, cur + y * m_width + x0, w);
+				sum += simd::sum(cur + y * m_width + x0, w);
+			}
+			// 平均亮度不变（如纹理移动）时也要发布
+			const size_t offset = ty * m_tiles_x + tx;
+			update(offset, static_cast<weight_t>(sum) / (255.0f * pixels));
+			mark_dirty(offset);
+		}
+	}
+}
+
+MYAI_END
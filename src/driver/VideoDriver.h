@@ -0,0 +1,105 @@
+#ifndef MYAI_DRIVER_VIDEO_H_
+#define MYAI_DRIVER_VIDEO_H_
+
+#include "Driver.h"
+
+#include <fstream>
+
+MYAI_BEGIN
+
+/**
+ * @brief 视频驱动
+ * @details id布局：分块输入(TILE_ID_SIZE) | 保留的控制id。
+ *          采样线程从 y4m 文件或原始 RGB24/GRAY8 帧流读取帧，只取亮度；
+ *          画面按 tile_size 分块，与参考帧逐块比较平均绝对差(SIMD SAD)，
+ *          超过阈值的块更新参考帧并发出输入，值为块的平均亮度(0~1)。
+ *          未变化的块不发布，输入量随画面运动而不是分辨率增长。
+ */
+class VideoDriver : public MyaiDriver {
+public:
+	using ptr							  = std::shared_ptr<VideoDriver>;
+	constexpr static size_t TILE_ID_SIZE  = 0x40'0000;
+	constexpr static uint32 DEF_TILE_SIZE = 16;
+	constexpr static float DEF_THRESHOLD  = 4.0f;
+	constexpr static double DEF_FPS		  = 30.0;
+
+	struct Options {
+		// 原始帧流的格式，y4m 以文件头为准
+		uint32 raw_width	= 0;
+		uint32 raw_height	= 0;
+		uint32 raw_channels = 3;// 3:RGB24 1:GRAY8
+		double raw_fps		= DEF_FPS;
+		bool realtime		= true;// 为假时尽快读取（离线文件）
+		uint32 tile_size	= DEF_TILE_SIZE;
+		float threshold		= DEF_THRESHOLD;// 块内每像素平均亮度差的阈值(0~255)
+	};
+
+	// input_path 为 "-" 时读取标准输入
+	VideoDriver(Type type, nodeid_t begin, size_t size, String input_path, Options options);
+	~VideoDriver() override { stop(); }
+
+	bool eof() const { return m_eof; }
+	uint32 width() const { return m_width; }
+	uint32 height() const { return m_height; }
+	size_t tile_num() const { return m_tiles_x * m_tiles_y; }
+	uint64 frame_count() const { return m_frame_count; }
+
+	// 控制id保留，暂无对应的设备
+	void control(const Edge *, size_t) override {}
+
+private:
+	virtual void collect_data() override;
+	virtual void regeiste_controls() override;
+
+	void read_header();
+	// 读取一帧的亮度到 m_luma，discard 为真时只跳过
+	bool read_frame(bool discard);
+	void diff_tiles();
+
+private:
+	String m_input_path;
+	Options m_options;
+
+	std::ifstream m_file;
+	std::istream *m_input = nullptr;
+	bool m_y4m			  = false;
+	uint32 m_width		  = 0;
+	uint32 m_height		  = 0;
+	double m_fps		  = DEF_FPS;
+	size_t m_chroma_size  = 0;// y4m 每帧跳过的色度字节
+	size_t m_tiles_x	  = 0;
+	size_t m_tiles_y	  = 0;
+	std::atomic<bool> m_eof{false};
+	std::chrono::steady_clock::time_point m_last_read;
+
+	std::vector<uint8_t> m_raw;		 // 原始帧，可能只读了一部分
+	size_t m_raw_size = 0;
+	std::vector<uint8_t> m_luma;	 // 当前帧亮度
+	std::vector<uint8_t> m_reference;// 各块上次发布时的亮度
+	std::atomic<uint64> m_frame_count{0};
+};
+
+//size = 40 0000H+4H
+class ScreenVideoDriver : public VideoDriver {
+public:
+	using ptr						= std::shared_ptr<ScreenVideoDriver>;
+	constexpr static size_t ID_SIZE = TILE_ID_SIZE + 0x4;
+
+	ScreenVideoDriver(nodeid_t begin, size_t size, String input_path, Options options = Options())
+		: VideoDriver(Type::DT_SCREEN_VIDEO, begin, size, std::move(input_path), options) {}
+	~ScreenVideoDriver() override { stop(); }
+};
+
+//size = 40 0000H+8H
+class CameraVideoDriver : public VideoDriver {
+public:
+	using ptr						= std::shared_ptr<CameraVideoDriver>;
+	constexpr static size_t ID_SIZE = TILE_ID_SIZE + 0x8;
+
+	CameraVideoDriver(nodeid_t begin, size_t size, String input_path, Options options = Options())
+		: VideoDriver(Type::DT_CAMERA_VIDEO, begin, size, std::move(input_path), options) {}
+	~CameraVideoDriver() override { stop(); }
+};
+
+MYAI_END
+#endif// !MYAI_DRIVER_VIDEO_H_